@@ -0,0 +1,23 @@
+// ==========================
+// Símbolos dos módulos que não entram no build do host
+// ==========================
+// ble_gatt.c e ble_adv.c dependem do controlador BLE; aqui só existe o
+// estado que ble_log.c, ble_live.c e temp_hum.c consultam.
+#include "ble_gatt.h"
+#include "ble_adv.h"
+
+uint8_t own_addr_type;
+uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
+
+void ble_link_set_fast(bool fast)
+{
+    (void)fast;
+}
+
+void ble_adv_refresh(void)
+{
+}
+
+void ble_post_adv_refresh(void)
+{
+}
@@ -0,0 +1,240 @@
+// ==========================
+// Fake do FreeRTOS sobre pthreads
+// ==========================
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+// ==========================
+// Espera com timeout em ticks
+// ==========================
+static void deadline_from_ticks(struct timespec *deadline, TickType_t ticks)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    uint64_t ns = (uint64_t)ticks * (1000000000ull / configTICK_RATE_HZ) + (uint64_t)deadline->tv_nsec;
+    deadline->tv_sec += (time_t)(ns / 1000000000ull);
+    deadline->tv_nsec = (long)(ns % 1000000000ull);
+}
+
+// Espera (com lock) até *value > 0; false se o tempo acabar antes
+static bool wait_nonzero(pthread_cond_t *cond, pthread_mutex_t *lock, const uint32_t *value, TickType_t ticks)
+{
+    struct timespec deadline;
+    if (ticks != portMAX_DELAY)
+        deadline_from_ticks(&deadline, ticks);
+
+    while (*value == 0)
+    {
+        if (ticks == 0)
+            return false;
+        if (ticks == portMAX_DELAY)
+            pthread_cond_wait(cond, lock);
+        else if (pthread_cond_timedwait(cond, lock, &deadline) == ETIMEDOUT)
+            return *value > 0;
+    }
+    return true;
+}
+
+// ==========================
+// Seções críticas
+// ==========================
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void critical_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void fake_port_enter_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void fake_port_exit_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+// ==========================
+// Tasks e notificações
+// ==========================
+struct fake_task
+{
+    TaskFunction_t code;
+    void *param;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+};
+
+static __thread struct fake_task *current_task = NULL;
+
+static struct fake_task *task_alloc(TaskFunction_t code, void *param)
+{
+    struct fake_task *task = calloc(1, sizeof(*task));
+    if (!task)
+        return NULL;
+
+    task->code = code;
+    task->param = param;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->cond, NULL);
+    return task;
+}
+
+// Threads que não nasceram de xTaskCreate (ex.: main do teste) ganham uma
+// task na primeira notificação
+static struct fake_task *task_self(void)
+{
+    if (!current_task)
+        current_task = task_alloc(NULL, NULL);
+    return current_task;
+}
+
+static void *task_entry(void *arg)
+{
+    current_task = arg;
+    current_task->code(current_task->param);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    struct fake_task *task = task_alloc(task_code, param);
+    if (!task)
+        return pdFAIL;
+
+    // O handle já vale quando a task começa a rodar
+    if (created_task)
+        *created_task = task;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_entry, task) != 0)
+        return pdFAIL;
+    pthread_detach(thread);
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0)
+    {
+        sched_yield();
+        return;
+    }
+
+    uint64_t ns = (uint64_t)ticks * (1000000000ull / configTICK_RATE_HZ);
+    struct timespec ts = {.tv_sec = (time_t)(ns / 1000000000ull), .tv_nsec = (long)(ns % 1000000000ull)};
+    nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)((uint64_t)ts.tv_sec * configTICK_RATE_HZ + (uint64_t)ts.tv_nsec / (1000000000ull / configTICK_RATE_HZ));
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify_value++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct fake_task *task = task_self();
+
+    pthread_mutex_lock(&task->lock);
+    wait_nonzero(&task->cond, &task->lock, &task->notify_value, ticks_to_wait);
+    uint32_t value = task->notify_value;
+    if (value > 0)
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+// ==========================
+// Semáforos
+// ==========================
+struct fake_semaphore
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max;
+};
+
+static SemaphoreHandle_t semaphore_create(uint32_t initial, uint32_t max)
+{
+    struct fake_semaphore *sem = calloc(1, sizeof(*sem));
+    if (!sem)
+        return NULL;
+
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->count = initial;
+    sem->max = max;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    pthread_mutex_lock(&semaphore->lock);
+    bool taken = wait_nonzero(&semaphore->cond, &semaphore->lock, &semaphore->count, ticks_to_wait);
+    if (taken)
+        semaphore->count--;
+    pthread_mutex_unlock(&semaphore->lock);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_lock(&semaphore->lock);
+    bool given = semaphore->count < semaphore->max;
+    if (given)
+    {
+        semaphore->count++;
+        pthread_cond_signal(&semaphore->cond);
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+    return given ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higher_priority_task_woken)
+{
+    if (higher_priority_task_woken)
+        *higher_priority_task_woken = pdFALSE;
+    return xSemaphoreGive(semaphore);
+}
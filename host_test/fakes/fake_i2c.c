@@ -0,0 +1,141 @@
+// ==========================
+// Fake do driver I2C master com um STH31 simulado
+// ==========================
+#include "driver/i2c_master.h"
+#include "fake_host.h"
+#include <stdlib.h>
+
+struct i2c_master_bus_t
+{
+    i2c_master_bus_config_t config;
+};
+
+struct i2c_master_dev_t
+{
+    i2c_device_config_t config;
+    i2c_master_callback_t on_trans_done;
+    void *user_data;
+};
+
+static uint16_t sensor_raw_temp = 0x6666; // ~25 °C
+static uint16_t sensor_raw_hum = 0x8000;  // ~50 %UR
+static uint32_t corrupt_reads = 0;
+static uint32_t nack_reads = 0;
+static uint16_t last_command = 0;
+
+void fake_sth31_set_raw(uint16_t raw_temp, uint16_t raw_hum)
+{
+    sensor_raw_temp = raw_temp;
+    sensor_raw_hum = raw_hum;
+}
+
+void fake_sth31_corrupt_reads(uint32_t count)
+{
+    corrupt_reads = count;
+}
+
+void fake_sth31_nack_reads(uint32_t count)
+{
+    nack_reads = count;
+}
+
+uint16_t fake_sth31_last_command(void)
+{
+    return last_command;
+}
+
+// CRC-8 do datasheet (polinômio 0x31, início 0xFF), bit a bit
+static uint8_t sth31_crc8(uint8_t msb, uint8_t lsb)
+{
+    uint8_t crc = 0xFF;
+    uint8_t bytes[2] = {msb, lsb};
+    for (int i = 0; i < 2; i++)
+    {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static void trans_done(i2c_master_dev_handle_t dev, i2c_master_event_t event)
+{
+    i2c_master_event_data_t data = {.event = event};
+    if (dev->on_trans_done)
+        dev->on_trans_done(dev, &data, dev->user_data);
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+    struct i2c_master_bus_t *bus = calloc(1, sizeof(*bus));
+    if (!bus)
+        return ESP_ERR_NO_MEM;
+
+    bus->config = *bus_config;
+    *ret_bus_handle = bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle)
+{
+    (void)bus_handle;
+    struct i2c_master_dev_t *dev = calloc(1, sizeof(*dev));
+    if (!dev)
+        return ESP_ERR_NO_MEM;
+
+    dev->config = *dev_config;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev,
+                                              const i2c_master_event_callbacks_t *cbs, void *user_data)
+{
+    i2c_dev->on_trans_done = cbs->on_trans_done;
+    i2c_dev->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    if (write_size != 2)
+        return ESP_ERR_INVALID_ARG;
+
+    last_command = (uint16_t)((write_buffer[0] << 8) | write_buffer[1]);
+    trans_done(i2c_dev, I2C_EVENT_DONE);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size,
+                             int xfer_timeout_ms)
+{
+    (void)xfer_timeout_ms;
+    if (read_size != 6)
+        return ESP_ERR_INVALID_ARG;
+
+    if (nack_reads > 0)
+    {
+        nack_reads--;
+        trans_done(i2c_dev, I2C_EVENT_NACK);
+        return ESP_OK;
+    }
+
+    read_buffer[0] = (uint8_t)(sensor_raw_temp >> 8);
+    read_buffer[1] = (uint8_t)sensor_raw_temp;
+    read_buffer[2] = sth31_crc8(read_buffer[0], read_buffer[1]);
+    read_buffer[3] = (uint8_t)(sensor_raw_hum >> 8);
+    read_buffer[4] = (uint8_t)sensor_raw_hum;
+    read_buffer[5] = sth31_crc8(read_buffer[3], read_buffer[4]);
+
+    if (corrupt_reads > 0)
+    {
+        corrupt_reads--;
+        read_buffer[5] ^= 0x01;
+    }
+
+    trans_done(i2c_dev, I2C_EVENT_DONE);
+    return ESP_OK;
+}
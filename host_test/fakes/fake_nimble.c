@@ -0,0 +1,274 @@
+// ==========================
+// Fake do host NimBLE
+// ==========================
+// Os eventos e callouts rodam só dentro de fake_nimble_run_until(), na thread
+// do teste, que faz o papel da task do host NimBLE.
+#include "host/ble_hs.h"
+#include "nimble/nimble_port.h"
+#include "esp_timer.h"
+#include "fake_host.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static struct ble_npl_eventq dflt_eventq;
+static pthread_mutex_t eventq_lock = PTHREAD_MUTEX_INITIALIZER; // eventq_put vem de outras tasks
+static struct ble_npl_callout *callouts = NULL;
+
+static fake_notify_fn *notify_hook = NULL;
+static uint32_t notify_failures = 0;
+static int notify_failure_rc = 0;
+static uint16_t att_mtu = 247;
+static struct ble_gap_conn_desc peer_desc;
+static uint32_t security_requests = 0;
+
+// ==========================
+// mbufs
+// ==========================
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    struct os_mbuf *om = calloc(1, sizeof(*om));
+    if (!om)
+        return NULL;
+
+    if (os_mbuf_append(om, buf, len) != 0)
+    {
+        free(om);
+        return NULL;
+    }
+    return om;
+}
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len)
+{
+    uint8_t *grown = realloc(om->om_data, (size_t)om->om_len + len + 1);
+    if (!grown)
+        return BLE_HS_ENOMEM;
+
+    memcpy(&grown[om->om_len], data, len);
+    om->om_data = grown;
+    om->om_len += len;
+    return 0;
+}
+
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst)
+{
+    if (off < 0 || len < 0 || off + len > om->om_len)
+        return -1;
+
+    memcpy(dst, &om->om_data[off], (size_t)len);
+    return 0;
+}
+
+int os_mbuf_free_chain(struct os_mbuf *om)
+{
+    if (om)
+    {
+        free(om->om_data);
+        free(om);
+    }
+    return 0;
+}
+
+// ==========================
+// GATT
+// ==========================
+void fake_nimble_set_notify_hook(fake_notify_fn *fn)
+{
+    notify_hook = fn;
+}
+
+void fake_nimble_fail_notify(uint32_t count, int rc)
+{
+    notify_failures = count;
+    notify_failure_rc = rc;
+}
+
+void fake_nimble_set_mtu(uint16_t mtu)
+{
+    att_mtu = mtu;
+}
+
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om)
+{
+    int rc = 0;
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE)
+    {
+        rc = BLE_HS_ENOTCONN;
+    }
+    else if (notify_failures > 0)
+    {
+        notify_failures--;
+        rc = notify_failure_rc;
+    }
+    else if (notify_hook)
+    {
+        notify_hook(att_handle, om->om_data, om->om_len);
+    }
+
+    os_mbuf_free_chain(om);
+    return rc;
+}
+
+uint16_t ble_att_mtu(uint16_t conn_handle)
+{
+    return conn_handle == BLE_HS_CONN_HANDLE_NONE ? 0 : att_mtu;
+}
+
+// ==========================
+// GAP
+// ==========================
+void fake_nimble_set_peer(uint8_t addr_type, const uint8_t addr[6], bool bonded)
+{
+    memset(&peer_desc, 0, sizeof(peer_desc));
+    peer_desc.peer_id_addr.type = addr_type;
+    memcpy(peer_desc.peer_id_addr.val, addr, sizeof(peer_desc.peer_id_addr.val));
+    peer_desc.peer_ota_addr = peer_desc.peer_id_addr;
+    peer_desc.sec_state.bonded = bonded;
+    peer_desc.sec_state.encrypted = bonded;
+}
+
+int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc *out_desc)
+{
+    if (handle == BLE_HS_CONN_HANDLE_NONE)
+        return BLE_HS_ENOTCONN;
+
+    *out_desc = peer_desc;
+    out_desc->conn_handle = handle;
+    return 0;
+}
+
+int ble_gap_security_initiate(uint16_t conn_handle)
+{
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE)
+        return BLE_HS_ENOTCONN;
+
+    security_requests++;
+    return 0;
+}
+
+uint32_t fake_nimble_security_requests(void)
+{
+    return security_requests;
+}
+
+// ==========================
+// Eventos e callouts
+// ==========================
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void)
+{
+    return &dflt_eventq;
+}
+
+void ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn, void *arg)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->fn = fn;
+    ev->arg = arg;
+}
+
+void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+{
+    pthread_mutex_lock(&eventq_lock);
+    if (!ev->queued)
+    {
+        ev->queued = true;
+        ev->next = NULL;
+        if (evq->tail)
+            evq->tail->next = ev;
+        else
+            evq->head = ev;
+        evq->tail = ev;
+    }
+    pthread_mutex_unlock(&eventq_lock);
+}
+
+static struct ble_npl_event *eventq_get(struct ble_npl_eventq *evq)
+{
+    pthread_mutex_lock(&eventq_lock);
+    struct ble_npl_event *ev = evq->head;
+    if (ev)
+    {
+        evq->head = ev->next;
+        if (!evq->head)
+            evq->tail = NULL;
+        ev->queued = false;
+    }
+    pthread_mutex_unlock(&eventq_lock);
+    return ev;
+}
+
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg)
+{
+    for (struct ble_npl_callout *it = callouts; it; it = it->next)
+    {
+        if (it == co)
+        {
+            co->active = false;
+            ble_npl_event_init(&co->ev, fn, arg);
+            co->evq = evq;
+            return;
+        }
+    }
+
+    memset(co, 0, sizeof(*co));
+    ble_npl_event_init(&co->ev, fn, arg);
+    co->evq = evq;
+    co->next = callouts;
+    callouts = co;
+}
+
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms)
+{
+    return ms; // Tick de 1 ms
+}
+
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks)
+{
+    co->deadline_us = esp_timer_get_time() + (int64_t)ticks * 1000;
+    co->active = true;
+    return 0;
+}
+
+void ble_npl_callout_stop(struct ble_npl_callout *co)
+{
+    co->active = false;
+}
+
+bool ble_npl_callout_is_active(struct ble_npl_callout *co)
+{
+    return co->active;
+}
+
+// ==========================
+// Laço do host
+// ==========================
+bool fake_nimble_run_until(bool (*done)(void), uint32_t timeout_ms)
+{
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+
+    while (!done())
+    {
+        if (esp_timer_get_time() >= deadline_us)
+            return false;
+
+        struct ble_npl_event *ev;
+        while ((ev = eventq_get(&dflt_eventq)) != NULL)
+            ev->fn(ev);
+
+        int64_t now_us = esp_timer_get_time();
+        for (struct ble_npl_callout *co = callouts; co; co = co->next)
+        {
+            if (co->active && co->deadline_us <= now_us)
+            {
+                co->active = false;
+                co->ev.fn(&co->ev);
+            }
+        }
+
+        struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000};
+        nanosleep(&idle, NULL);
+    }
+    return true;
+}
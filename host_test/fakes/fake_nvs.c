@@ -0,0 +1,212 @@
+// ==========================
+// Fake da NVS: chaves em RAM
+// ==========================
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "fake_host.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAKE_NVS_MAX_ENTRIES 256
+#define FAKE_NVS_MAX_NAMESPACES 8
+
+typedef enum
+{
+    ENTRY_U32,
+    ENTRY_BLOB,
+} entry_type_t;
+
+typedef struct
+{
+    bool used;
+    nvs_handle_t ns;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    entry_type_t type;
+    uint32_t u32;
+    uint8_t *blob;
+    size_t len;
+} nvs_entry_t;
+
+static nvs_entry_t entries[FAKE_NVS_MAX_ENTRIES];
+static char namespaces[FAKE_NVS_MAX_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static bool initialized = false;
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER; // A API da NVS é thread-safe
+
+static void entry_clear(nvs_entry_t *entry)
+{
+    free(entry->blob);
+    memset(entry, 0, sizeof(*entry));
+}
+
+void fake_nvs_reset(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+        entry_clear(&entries[i]);
+    memset(namespaces, 0, sizeof(namespaces));
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    fake_nvs_reset();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)open_mode;
+    if (!initialized)
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (strlen(namespace_name) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+
+    esp_err_t err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    pthread_mutex_lock(&nvs_lock);
+    for (nvs_handle_t i = 0; i < FAKE_NVS_MAX_NAMESPACES; i++)
+    {
+        if (namespaces[i][0] == '\0')
+            strcpy(namespaces[i], namespace_name);
+        if (strcmp(namespaces[i], namespace_name) == 0)
+        {
+            *out_handle = i + 1; // 0 não é handle válido
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return handle == 0 ? ESP_ERR_NVS_INVALID_HANDLE : ESP_OK;
+}
+
+// Chamado com nvs_lock
+static nvs_entry_t *entry_find(nvs_handle_t handle, const char *key, entry_type_t type)
+{
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        nvs_entry_t *entry = &entries[i];
+        if (entry->used && entry->ns == handle && entry->type == type && strcmp(entry->key, key) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+// Chamado com nvs_lock: entrada existente (zerada) ou nova
+static esp_err_t entry_store(nvs_handle_t handle, const char *key, entry_type_t type, nvs_entry_t **out)
+{
+    if (handle == 0)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+
+    nvs_entry_t *entry = entry_find(handle, key, type);
+    for (size_t i = 0; !entry && i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        if (!entries[i].used)
+            entry = &entries[i];
+    }
+    if (!entry)
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+    entry_clear(entry);
+    entry->used = true;
+    entry->ns = handle;
+    entry->type = type;
+    strcpy(entry->key, key);
+    *out = entry;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *entry = entry_find(handle, key, ENTRY_U32);
+    if (entry)
+        *out_value = entry->u32;
+    pthread_mutex_unlock(&nvs_lock);
+    return entry ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *entry;
+    esp_err_t err = entry_store(handle, key, ENTRY_U32, &entry);
+    if (err == ESP_OK)
+        entry->u32 = value;
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *entry = entry_find(handle, key, ENTRY_BLOB);
+    if (!entry)
+        err = ESP_ERR_NVS_NOT_FOUND;
+    else if (out_value && *length < entry->len)
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    else if (out_value)
+        memcpy(out_value, entry->blob, entry->len);
+    if (entry)
+        *length = entry->len; // Com out_value NULL, só consulta o tamanho
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    uint8_t *copy = malloc(length > 0 ? length : 1);
+    if (!copy)
+        return ESP_ERR_NO_MEM;
+    memcpy(copy, value, length);
+
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *entry;
+    esp_err_t err = entry_store(handle, key, ENTRY_BLOB, &entry);
+    if (err == ESP_OK)
+    {
+        entry->blob = copy;
+        entry->len = length;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+
+    if (err != ESP_OK)
+        free(copy);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&nvs_lock);
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        nvs_entry_t *entry = &entries[i];
+        if (entry->used && entry->ns == handle && strcmp(entry->key, key) == 0)
+        {
+            entry_clear(entry);
+            err = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
@@ -0,0 +1,90 @@
+// ==========================
+// Fake de esp_partition: partição "datalog" em RAM
+// ==========================
+#include "esp_partition.h"
+#include "fake_host.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FAKE_FLASH_SECTOR_SIZE 4096
+
+static uint8_t *flash = NULL;
+static esp_partition_t partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_ANY,
+    .erase_size = FAKE_FLASH_SECTOR_SIZE,
+    .label = "datalog",
+};
+static uint32_t read_count = 0;
+static uint32_t erase_count = 0;
+
+void fake_flash_init(uint32_t sectors)
+{
+    free(flash);
+    partition.size = sectors * FAKE_FLASH_SECTOR_SIZE;
+    flash = malloc(partition.size);
+    memset(flash, 0xFF, partition.size);
+    read_count = 0;
+    erase_count = 0;
+}
+
+uint32_t fake_flash_reads(void)
+{
+    return read_count;
+}
+
+uint32_t fake_flash_erases(void)
+{
+    return erase_count;
+}
+
+static bool in_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    return part == &partition && offset <= partition.size && size <= partition.size - offset;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)subtype;
+    if (type != ESP_PARTITION_TYPE_DATA || !label || strcmp(label, partition.label) != 0)
+        return NULL;
+
+    if (!flash)
+        fake_flash_init(FAKE_FLASH_DEFAULT_SECTORS);
+    return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size)
+{
+    if (!in_range(part, src_offset, size))
+        return ESP_ERR_INVALID_SIZE;
+
+    read_count++;
+    memcpy(dst, &flash[src_offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size)
+{
+    if (!in_range(part, dst_offset, size))
+        return ESP_ERR_INVALID_SIZE;
+
+    // NOR flash: a gravação só leva bits de 1 para 0
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++)
+        flash[dst_offset + i] &= bytes[i];
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (!in_range(part, offset, size))
+        return ESP_ERR_INVALID_SIZE;
+    if (offset % FAKE_FLASH_SECTOR_SIZE != 0 || size % FAKE_FLASH_SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_ARG;
+
+    erase_count += size / FAKE_FLASH_SECTOR_SIZE;
+    memset(&flash[offset], 0xFF, size);
+    return ESP_OK;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Fake de esp_attr.h: no host não há RAM RTC nem IRAM
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
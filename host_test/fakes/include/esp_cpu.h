@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// No host o "ciclo" é 1 ns do relógio monotônico
+uint32_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,41 @@
+#pragma once
+
+// ==========================
+// Controle dos fakes (só para os testes e benchmarks no host)
+// ==========================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flash: partição "datalog" em RAM. Sem chamada explícita, é criada no
+// primeiro esp_partition_find_first() com o tamanho da tabela de partições
+// (752 setores de 4 KB), toda apagada.
+#define FAKE_FLASH_DEFAULT_SECTORS 752
+
+void fake_flash_init(uint32_t sectors);
+uint32_t fake_flash_reads(void);   // Chamadas a esp_partition_read desde o init
+uint32_t fake_flash_erases(void);  // Setores apagados desde o init
+
+// NVS: apaga todas as chaves
+void fake_nvs_reset(void);
+
+// NimBLE
+typedef void fake_notify_fn(uint16_t attr_handle, const uint8_t *data, uint16_t len);
+
+void fake_nimble_set_notify_hook(fake_notify_fn *fn);
+// As próximas count notificações falham com rc (ex.: BLE_HS_ENOMEM)
+void fake_nimble_fail_notify(uint32_t count, int rc);
+void fake_nimble_set_mtu(uint16_t mtu);
+// Peer retornado por ble_gap_conn_find para qualquer conexão válida
+void fake_nimble_set_peer(uint8_t addr_type, const uint8_t addr[6], bool bonded);
+// Chamadas a ble_gap_security_initiate desde o início
+uint32_t fake_nimble_security_requests(void);
+// Executa eventos e callouts do host NimBLE na thread chamadora até done()
+// retornar true ou timeout_ms passar. Retorna done().
+bool fake_nimble_run_until(bool (*done)(void), uint32_t timeout_ms);
+
+// STH31 simulado no barramento I2C
+void fake_sth31_set_raw(uint16_t raw_temp, uint16_t raw_hum);
+void fake_sth31_corrupt_reads(uint32_t count); // Próximas leituras com CRC inválido
+void fake_sth31_nack_reads(uint32_t count);    // Próximas leituras sem ACK
+uint16_t fake_sth31_last_command(void);
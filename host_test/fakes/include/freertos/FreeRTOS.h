@@ -0,0 +1,36 @@
+#pragma once
+
+// Fake do FreeRTOS sobre pthreads. Tick de 10 ms, como no sdkconfig do
+// firmware (CONFIG_FREERTOS_HZ=100). As seções críticas usam um único mutex
+// recursivo global, como o núcleo único do ESP32-C3.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 100
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void fake_port_enter_critical(portMUX_TYPE *mux);
+void fake_port_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) fake_port_enter_critical(mux)
+#define portEXIT_CRITICAL(mux) fake_port_exit_critical(mux)
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
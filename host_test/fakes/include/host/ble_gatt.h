@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include "host/ble_uuid.h"
+
+struct os_mbuf;
+
+#define BLE_GATT_ACCESS_OP_READ_CHR 0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR 1
+#define BLE_GATT_ACCESS_OP_READ_DSC 2
+#define BLE_GATT_ACCESS_OP_WRITE_DSC 3
+
+struct ble_gatt_access_ctxt
+{
+    uint8_t op;
+    struct os_mbuf *om;
+};
+
+// Como no NimBLE, o mbuf é sempre consumido (também em caso de erro)
+int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om);
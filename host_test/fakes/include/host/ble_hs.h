@@ -0,0 +1,84 @@
+#pragma once
+
+// Fake do host NimBLE: mbufs planos, notificações entregues a um hook e uma
+// única fila de eventos, executada pela thread do teste (fake_nimble_run).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "host/ble_gap.h"
+#include "host/ble_gatt.h"
+#include "host/ble_uuid.h"
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+
+#define BLE_HS_EAGAIN 1
+#define BLE_HS_EALREADY 2
+#define BLE_HS_EINVAL 3
+#define BLE_HS_EMSGSIZE 4
+#define BLE_HS_ENOENT 5
+#define BLE_HS_ENOMEM 6
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_ENOTSUP 8
+#define BLE_HS_EBUSY 15
+
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN 0x0d
+#define BLE_ATT_ERR_UNLIKELY 0x0e
+#define BLE_ATT_ERR_INSUFFICIENT_RES 0x11
+
+// ==========================
+// mbufs
+// ==========================
+struct os_mbuf
+{
+    uint8_t *om_data;
+    uint16_t om_len;
+};
+
+#define OS_MBUF_PKTLEN(om) ((om)->om_len)
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst);
+int os_mbuf_free_chain(struct os_mbuf *om);
+
+uint16_t ble_att_mtu(uint16_t conn_handle);
+
+// ==========================
+// Eventos e callouts (NPL)
+// ==========================
+struct ble_npl_event;
+typedef void ble_npl_event_fn(struct ble_npl_event *ev);
+
+struct ble_npl_event
+{
+    ble_npl_event_fn *fn;
+    void *arg;
+    bool queued;
+    struct ble_npl_event *next;
+};
+
+struct ble_npl_eventq
+{
+    struct ble_npl_event *head;
+    struct ble_npl_event *tail;
+};
+
+struct ble_npl_callout
+{
+    struct ble_npl_event ev;
+    struct ble_npl_eventq *evq;
+    int64_t deadline_us;
+    bool active;
+    struct ble_npl_callout *next; // Lista de callouts inicializados
+};
+
+typedef uint32_t ble_npl_time_t;
+
+void ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn, void *arg);
+void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg);
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *co);
+bool ble_npl_callout_is_active(struct ble_npl_callout *co);
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+#define BLE_UUID_TYPE_16 16
+
+typedef struct
+{
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct
+{
+    ble_uuid_t u;
+    uint16_t value;
+} ble_uuid16_t;
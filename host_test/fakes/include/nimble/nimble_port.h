@@ -0,0 +1,5 @@
+#pragma once
+
+#include "host/ble_hs.h"
+
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void);
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "nimble/nimble_port.h"
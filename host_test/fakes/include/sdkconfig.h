@@ -0,0 +1,3 @@
+#pragma once
+
+// Build no host: nenhuma opção do menuconfig ligada
@@ -0,0 +1,14 @@
+// ==========================
+// Benchmark da serialização no host
+// ==========================
+// Roda serial_bench_run() (equivalência com o nanopb e linhas BENCH,...).
+// No host, "ciclos" são nanossegundos (fake de esp_cpu_get_cycle_count).
+#include "serial_bench.h"
+#include "esp_log.h"
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_INFO);
+    serial_bench_run();
+    return 0;
+}
@@ -0,0 +1,300 @@
+// ==========================
+// Pipeline do log: amostras -> task de gravação -> flash -> download BLE
+// ==========================
+// nvs_controller.c e ble_log.c rodam sobre os fakes: a task de gravação é uma
+// thread e esta thread faz o papel do host NimBLE (fake_nimble_run_until).
+// Cobre a migração das chaves antigas da NVS, o download em streaming com
+// amostras ainda no buffer de gravação e falta de mbufs, o modo NEXT com STOP
+// no fim, GETLENGTH, a janela
+// de amostras recentes, o pareamento pedido só no ACK e o CLEAR.
+#include "nvs_controller.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "log_store.h"
+#include "ble_gatt.h"
+#include "ble_log.h"
+#include "serial.h"
+#include "fake_host.h"
+#include "test_util.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LEGACY_SAMPLES 5
+#define NEW_SAMPLES 600 // Não é múltiplo de LOG_STAGE_SAMPLES: sobra amostra no buffer
+#define TOTAL_SAMPLES (LEGACY_SAMPLES + NEW_SAMPLES)
+#define RECENT_WINDOW 32
+#define WAIT_MS 5000
+
+#define LOG_CHAR_HANDLE 10
+#define LOG_CTRL_CHAR_HANDLE 11
+
+static SensorData expected[TOTAL_SAMPLES];
+
+// Recebido pelo "cliente"
+static SensorData received[TOTAL_SAMPLES + 1];
+static uint32_t received_seqs[TOTAL_SAMPLES + 1];
+static size_t received_count = 0;
+static bool stop_received = false;
+static uint32_t stop_value = 0;
+static bool length_received = false;
+static uint32_t length_value = 0;
+
+static SensorData make_sample(uint32_t i)
+{
+    SensorData sample = {
+        .timestamp = 1700000000u + i * 60u,
+        .temperature = 20.0f + (float)(i % 500) * 0.01f,
+        .humidity = 40.0f + (float)(i % 300) * 0.05f,
+    };
+    return sample;
+}
+
+static void on_notify(uint16_t attr_handle, const uint8_t *data, uint16_t len)
+{
+    if (attr_handle == LOG_CHAR_HANDLE)
+    {
+        SensorDataBatch batch;
+        pb_istream_t input = pb_istream_from_buffer(data, len);
+        CHECK(pb_decode(&input, SensorDataBatch_fields, &batch));
+        CHECK(batch.temperatures_count == batch.delta_timestamps_count &&
+              batch.humidities_count == batch.delta_timestamps_count);
+
+        for (pb_size_t i = 0; i < batch.delta_timestamps_count && received_count <= TOTAL_SAMPLES; i++)
+        {
+            SensorData *sample = &received[received_count];
+            sample->timestamp = batch.base_timestamp + (uint64_t)i * batch.interval + batch.delta_timestamps[i];
+            sample->temperature = dequantizeCenti(batch.temperatures[i]);
+            sample->humidity = dequantizeCenti(batch.humidities[i]);
+            received_seqs[received_count++] = batch.first_seq + i;
+        }
+    }
+    else if (attr_handle == LOG_CTRL_CHAR_HANDLE)
+    {
+        LogControl control;
+        CHECK(deserializeLogControl(data, len, &control));
+        if (control.command == LogControl_Command_STOP)
+        {
+            stop_received = true;
+            stop_value = control.length;
+        }
+        else if (control.command == LogControl_Command_GETLENGTH)
+        {
+            length_received = true;
+            length_value = control.length;
+        }
+    }
+}
+
+static bool transfer_done(void)
+{
+    return stop_received;
+}
+
+static bool length_done(void)
+{
+    return length_received;
+}
+
+static void write_control(LogControl_Command command, uint32_t value)
+{
+    uint8_t buffer[LogControl_size];
+    size_t len = sizeof(buffer);
+    CHECK(serializeLogControl(buffer, &len, command, value));
+
+    struct ble_gatt_access_ctxt ctxt = {
+        .op = BLE_GATT_ACCESS_OP_WRITE_CHR,
+        .om = ble_hs_mbuf_from_flat(buffer, (uint16_t)len),
+    };
+    CHECK(log_gatt_access_cb(conn_handle, log_ctrl_char_handle, &ctxt, NULL) == 0);
+    os_mbuf_free_chain(ctxt.om);
+}
+
+static uint32_t request_length(void)
+{
+    length_received = false;
+    write_control(LogControl_Command_GETLENGTH, 0);
+    CHECK(fake_nimble_run_until(length_done, WAIT_MS));
+    return length_value;
+}
+
+// Espera a task de gravação aceitar todas as amostras enfileiradas
+static bool wait_count(uint32_t count)
+{
+    for (int waited = 0; waited < WAIT_MS; waited += 10)
+    {
+        uint32_t current = 0;
+        nvs_get_sensor_data_count(&current);
+        if (current == count)
+            return true;
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+static bool same_sample(const SensorData *a, const SensorData *b)
+{
+    return a->timestamp == b->timestamp && quantizeCenti(a->temperature) == quantizeCenti(b->temperature) &&
+           quantizeCenti(a->humidity) == quantizeCenti(b->humidity);
+}
+
+// Formato antigo: uma chave NVS por amostra (sd_0, sd_1, ...) e sd_count
+static void store_legacy_samples(void)
+{
+    nvs_handle_t handle;
+    CHECK(nvs_flash_init() == ESP_OK);
+    CHECK(nvs_open("storage", NVS_READWRITE, &handle) == ESP_OK);
+
+    for (uint32_t i = 0; i < LEGACY_SAMPLES; i++)
+    {
+        uint8_t buffer[SensorData_size];
+        size_t len = sizeof(buffer);
+        CHECK(serializeSensorDataFromStruct(buffer, &len, &expected[i]));
+
+        char key[16];
+        snprintf(key, sizeof(key), "sd_%lu", (unsigned long)i);
+        CHECK(nvs_set_blob(handle, key, buffer, len) == ESP_OK);
+    }
+    CHECK(nvs_set_u32(handle, "sd_count", LEGACY_SAMPLES) == ESP_OK);
+}
+
+static void test_download(void)
+{
+    uint32_t oldest = log_store_oldest_seq();
+
+    // Falta de mbufs no início do streaming: retomada pelo callout
+    fake_nimble_fail_notify(3, BLE_HS_ENOMEM);
+    write_control(LogControl_Command_START, 0);
+    write_control(LogControl_Command_CREDIT, 1000);
+    CHECK(fake_nimble_run_until(transfer_done, WAIT_MS));
+
+    CHECK(stop_value == TOTAL_SAMPLES);
+    CHECK(received_count == TOTAL_SAMPLES);
+    for (size_t i = 0; i < received_count && i < TOTAL_SAMPLES; i++)
+    {
+        CHECK(received_seqs[i] == oldest + i);
+        CHECK(same_sample(&received[i], &expected[i]));
+    }
+}
+
+static size_t progress_mark = 0;
+
+static bool batch_or_stop(void)
+{
+    return received_count != progress_mark || stop_received;
+}
+
+// Modo sem créditos: um lote por NEXT; o último lote é seguido de STOP, e um
+// NEXT depois do fim repete o STOP
+static void test_next_requests(void)
+{
+    uint32_t oldest = log_store_oldest_seq();
+    received_count = 0;
+    stop_received = false;
+
+    progress_mark = 0;
+    write_control(LogControl_Command_START, 0);
+    CHECK(fake_nimble_run_until(batch_or_stop, WAIT_MS));
+    while (!stop_received && test_failures == 0)
+    {
+        progress_mark = received_count;
+        write_control(LogControl_Command_NEXT, 0);
+        CHECK(fake_nimble_run_until(batch_or_stop, WAIT_MS));
+    }
+
+    CHECK(stop_value == TOTAL_SAMPLES);
+    CHECK(received_count == TOTAL_SAMPLES);
+    for (size_t i = 0; i < received_count && i < TOTAL_SAMPLES; i++)
+        CHECK(received_seqs[i] == oldest + i);
+
+    stop_received = false;
+    stop_value = 0;
+    write_control(LogControl_Command_NEXT, 0);
+    CHECK(stop_received && stop_value == TOTAL_SAMPLES);
+}
+
+static void test_recent_window(void)
+{
+    SensorData window[RECENT_WINDOW];
+    uint32_t seqs[RECENT_WINDOW];
+    size_t count = 0;
+
+    CHECK(nvs_log_read_recent(window, seqs, RECENT_WINDOW, &count) == ESP_OK);
+    CHECK(count == RECENT_WINDOW);
+    for (size_t i = 0; i < count; i++)
+    {
+        CHECK(seqs[i] == nvs_log_end_seq() - RECENT_WINDOW + i);
+        CHECK(same_sample(&window[i], &expected[TOTAL_SAMPLES - RECENT_WINDOW + i]));
+    }
+}
+
+// Download e GETLENGTH não pedem pareamento; o primeiro ACK pede, uma vez
+static void test_bond_on_ack(void)
+{
+    CHECK(fake_nimble_security_requests() == 0);
+    write_control(LogControl_Command_ACK, 0);
+    CHECK(fake_nimble_security_requests() == 1);
+    write_control(LogControl_Command_ACK, 0);
+    CHECK(fake_nimble_security_requests() == 1);
+}
+
+static void test_clear(void)
+{
+    write_control(LogControl_Command_CLEAR, 0);
+
+    // Visto vazio na hora; a task de gravação apaga em seguida
+    uint32_t count = 1;
+    nvs_get_sensor_data_count(&count);
+    CHECK(count == 0);
+    CHECK(wait_count(0));
+    for (int waited = 0; log_store_count() != 0 && waited < WAIT_MS; waited += 10)
+        vTaskDelay(1);
+    CHECK(log_store_count() == 0);
+
+    SensorData sample = make_sample(TOTAL_SAMPLES);
+    CHECK(nvs_enqueue_sensor_data(&sample) == ESP_OK);
+    CHECK(wait_count(1));
+    CHECK(request_length() == 1);
+}
+
+int main(void)
+{
+    for (uint32_t i = 0; i < TOTAL_SAMPLES; i++)
+        expected[i] = make_sample(i);
+
+    esp_log_level_set("*", ESP_LOG_ERROR); // Avisos de fila cheia são esperados
+    fake_flash_init(16);
+    store_legacy_samples();
+    CHECK(nvs_controller_init() == ESP_OK);
+
+    // Chaves antigas migradas para o log e apagadas
+    nvs_handle_t handle;
+    uint32_t legacy_count;
+    CHECK(nvs_open("storage", NVS_READWRITE, &handle) == ESP_OK);
+    CHECK(nvs_get_u32(handle, "sd_count", &legacy_count) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(log_store_count() == LEGACY_SAMPLES);
+
+    conn_handle = 1;
+    log_char_handle = LOG_CHAR_HANDLE;
+    log_ctrl_char_handle = LOG_CTRL_CHAR_HANDLE;
+    fake_nimble_set_notify_hook(on_notify);
+
+    for (uint32_t i = LEGACY_SAMPLES; i < TOTAL_SAMPLES; i++)
+    {
+        // Fila cheia: espera a task de gravação esvaziar
+        while (nvs_enqueue_sensor_data(&expected[i]) == ESP_ERR_NO_MEM)
+            vTaskDelay(1);
+    }
+    CHECK(wait_count(TOTAL_SAMPLES));
+    CHECK(log_store_next_seq() < nvs_log_end_seq()); // Parte ainda no buffer de gravação
+    CHECK(request_length() == TOTAL_SAMPLES);
+
+    test_recent_window();
+    test_download();
+    test_next_requests();
+    test_bond_on_ack();
+    test_clear();
+
+    return test_result("log_download");
+}
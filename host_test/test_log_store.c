@@ -0,0 +1,237 @@
+// ==========================
+// log_store: recuperação no boot e busca por tempo
+// ==========================
+// Inclui log_store.c para reiniciar o estado estático e simular reboots
+// sobre a mesma flash (fake de esp_partition).
+#include "log_store.c"
+#include "fake_host.h"
+#include "test_util.h"
+
+#define RECOVERY_ITERATIONS 20000
+#define TIME_ITERATIONS 4000
+#define TIME_READ_CHUNK 64
+
+static void reboot(void)
+{
+    partition = NULL;
+    sector_count = 0;
+    atomic_store(&next_seq, 0);
+    atomic_store(&oldest_seq, 0);
+    base_seq = 0;
+    ready_sector = UINT32_MAX;
+    free(spans);
+    spans = NULL;
+    CHECK(log_store_init() == ESP_OK);
+}
+
+static void append_samples(int count, uint32_t *timestamp, uint32_t step)
+{
+    for (int i = 0; i < count; i++)
+    {
+        SensorData sample = {.timestamp = *timestamp, .temperature = 21.5f, .humidity = 48.25f};
+        *timestamp += step;
+        log_store_append_batch(&sample, 1);
+    }
+}
+
+static uint32_t ceil_log2(uint32_t value)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < value)
+        bits++;
+    return bits;
+}
+
+// Queda de energia ao abrir o próximo setor: apagado, mas sem cabeçalho
+static void power_cut_while_opening(void)
+{
+    uint32_t seq = atomic_load(&next_seq);
+    uint32_t sector = (seq + LOG_STORE_PREPARE_FREE) / LOG_STORE_RECORDS_PER_SECTOR;
+    if (seq % LOG_STORE_RECORDS_PER_SECTOR == 0)
+        sector = seq / LOG_STORE_RECORDS_PER_SECTOR;
+
+    if (sector * LOG_STORE_RECORDS_PER_SECTOR >= seq && ready_sector != sector)
+        esp_partition_erase_range(partition, sector_offset(sector), LOG_STORE_SECTOR_SIZE);
+    reboot();
+}
+
+// ==========================
+// Recuperação
+// ==========================
+// Sequências aleatórias de gravações, clears, preparos de setor e reboots
+// (com e sem queda durante a abertura de um setor): após um reboot limpo a
+// faixa [oldest, next) é a mesma, todos os registros dela são legíveis e a
+// recuperação faz um número logarítmico de leituras.
+static void test_recovery(uint32_t sectors, unsigned seed)
+{
+    fake_flash_init(sectors);
+    srand(seed);
+    reboot();
+
+    uint32_t max_boot_reads = 2 * ceil_log2(sectors) + 2 * ceil_log2(LOG_STORE_RECORDS_PER_SECTOR) + 8;
+    uint32_t timestamp = 1;
+
+    for (int it = 0; it < RECOVERY_ITERATIONS && test_failures == 0; it++)
+    {
+        int op = rand() % 100;
+        if (op < 60)
+        {
+            append_samples(rand() % (op < 10 ? 600 : 40), &timestamp, 1);
+        }
+        else if (op < 64)
+        {
+            log_store_clear();
+        }
+        else if (op < 75)
+        {
+            log_store_prepare();
+        }
+        else if (op < 80)
+        {
+            power_cut_while_opening();
+        }
+        else
+        {
+            uint32_t oldest = atomic_load(&oldest_seq), next = atomic_load(&next_seq);
+            // Clear cujo setor novo ainda não foi preparado não sobrevive ao reboot
+            bool clear_pending = next % LOG_STORE_RECORDS_PER_SECTOR == 0 &&
+                                 ready_sector != next / LOG_STORE_RECORDS_PER_SECTOR;
+            reboot();
+
+            if (!clear_pending)
+            {
+                CHECK(atomic_load(&oldest_seq) == oldest);
+                CHECK(atomic_load(&next_seq) == next);
+            }
+            CHECK(boot_reads <= max_boot_reads);
+        }
+
+        if (op >= 75)
+        {
+            log_record_t rec;
+            for (uint32_t seq = atomic_load(&oldest_seq); seq < atomic_load(&next_seq); seq++)
+            {
+                if (!read_record(seq, &rec))
+                {
+                    CHECK(!"registro ilegível em [oldest, next)");
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// ==========================
+// Busca por tempo
+// ==========================
+// Mesma varredura de nvs_log_cursor_next (seek pelo índice + filtro por
+// registro) comparada a um filtro força bruta sobre todos os registros.
+static void check_time_query(uint32_t from_time, uint32_t to_time)
+{
+    uint32_t oldest = log_store_oldest_seq(), end = log_store_next_seq();
+    uint32_t *found = malloc((end - oldest + 1) * sizeof(found[0]));
+    size_t found_count = 0;
+
+    static SensorData chunk[TIME_READ_CHUNK];
+    static uint32_t chunk_seqs[TIME_READ_CHUNK];
+    uint32_t seq = oldest;
+    while (seq < end)
+    {
+        seq = log_store_seek_time(seq, end, from_time, to_time);
+        if (seq >= end)
+            break;
+
+        size_t read = 0;
+        log_store_read(&seq, end, chunk, chunk_seqs, TIME_READ_CHUNK, &read);
+        for (size_t i = 0; i < read; i++)
+        {
+            if (chunk[i].timestamp >= from_time && chunk[i].timestamp <= to_time)
+                found[found_count++] = chunk_seqs[i];
+        }
+    }
+
+    size_t expected_count = 0;
+    log_record_t rec;
+    for (uint32_t s = oldest; s < end; s++)
+    {
+        if (!read_record(s, &rec) || rec.timestamp < from_time || rec.timestamp > to_time)
+            continue;
+        CHECK(expected_count < found_count && found[expected_count] == s);
+        expected_count++;
+    }
+    CHECK(expected_count == found_count);
+    free(found);
+}
+
+// O relógio volta a cada reboot (recomeça do horário de build): os setores
+// têm faixas de tempo sobrepostas e parte deles ainda não está indexada
+static void test_time_query(uint32_t sectors, unsigned seed)
+{
+    fake_flash_init(sectors);
+    srand(seed);
+    reboot();
+
+    const uint32_t clock_base = 1000000;
+    uint32_t timestamp = clock_base;
+
+    for (int it = 0; it < TIME_ITERATIONS && test_failures == 0; it++)
+    {
+        int op = rand() % 100;
+        if (op < 60)
+        {
+            append_samples(rand() % 40, &timestamp, 60);
+        }
+        else if (op < 62)
+        {
+            log_store_clear();
+        }
+        else if (op < 70)
+        {
+            log_store_prepare();
+        }
+        else if (op < 75)
+        {
+            reboot();
+            timestamp = clock_base + (uint32_t)(rand() % 5000);
+        }
+        else if (op < 85)
+        {
+            for (int steps = rand() % 4; steps > 0 && log_store_index_step(); steps--)
+                ;
+        }
+        else
+        {
+            uint32_t from_time = clock_base + (uint32_t)rand() % (timestamp - clock_base + 100);
+            check_time_query(from_time, from_time + (uint32_t)(rand() % 20000));
+        }
+    }
+
+    // Com o índice completo
+    while (log_store_index_step())
+        ;
+    for (int i = 0; i < 200 && test_failures == 0; i++)
+    {
+        uint32_t from_time = clock_base + (uint32_t)rand() % (timestamp - clock_base + 100);
+        check_time_query(from_time, from_time + (uint32_t)(rand() % 20000));
+    }
+}
+
+int main(void)
+{
+    static const uint32_t recovery_sectors[] = {2, 3, 8, FAKE_FLASH_DEFAULT_SECTORS};
+    static const uint32_t time_sectors[] = {2, 3, 8, 40};
+
+    for (size_t i = 0; i < sizeof(recovery_sectors) / sizeof(recovery_sectors[0]); i++)
+    {
+        for (unsigned seed = 1; seed <= 3; seed++)
+            test_recovery(recovery_sectors[i], seed);
+    }
+
+    for (size_t i = 0; i < sizeof(time_sectors) / sizeof(time_sectors[0]); i++)
+    {
+        for (unsigned seed = 1; seed <= 4; seed++)
+            test_time_query(time_sectors[i], seed);
+    }
+
+    return test_result("log_store");
+}
@@ -0,0 +1,148 @@
+// ==========================
+// Codec especializado x nanopb
+// ==========================
+// encode*Fast deve gerar exatamente os bytes do pb_encode e decode*Fast deve
+// aceitar/recusar as mesmas entradas que o pb_decode, com o mesmo resultado.
+#include "serial.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CODEC_ITERATIONS 300000
+
+static uint32_t rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// Valores de 64 bits com todos os tamanhos de varint
+static uint64_t rand_varint64(void)
+{
+    return ((uint64_t)rand32() << 32 | rand32()) >> (rand() % 64);
+}
+
+static float rand_float_bits(void)
+{
+    uint32_t bits = rand32();
+    switch (rand() % 4)
+    {
+    case 0:
+        bits = 0; // Campo omitido pelo nanopb
+        break;
+    case 1:
+        bits = 0x80000000u; // -0.0: diferente de zero em bits
+        break;
+    default:
+        break;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Campo a campo: o LogControl tem padding, que nenhum dos decoders preenche
+static bool same_log_control(const LogControl *a, const LogControl *b)
+{
+    return a->command == b->command && a->length == b->length && a->from_seq == b->from_seq &&
+           a->from_time == b->from_time && a->to_time == b->to_time;
+}
+
+static void check_sensor_data(const SensorData *data)
+{
+    uint8_t expected[SensorData_size], actual[SensorData_size];
+
+    pb_ostream_t stream = pb_ostream_from_buffer(expected, sizeof(expected));
+    CHECK(pb_encode(&stream, SensorData_fields, data));
+    size_t expected_len = stream.bytes_written;
+
+    size_t actual_len = sizeof(actual);
+    CHECK(encodeSensorDataFast(actual, &actual_len, data));
+    CHECK(actual_len == expected_len && memcmp(actual, expected, expected_len) == 0);
+
+    // Buffer pequeno demais: falha como o pb_encode
+    for (size_t capacity = 0; capacity < expected_len; capacity++)
+    {
+        size_t len = capacity;
+        CHECK(!encodeSensorDataFast(actual, &len, data));
+    }
+
+    SensorData by_nanopb, by_fast;
+    pb_istream_t input = pb_istream_from_buffer(expected, expected_len);
+    CHECK(pb_decode(&input, SensorData_fields, &by_nanopb));
+    CHECK(decodeSensorDataFast(expected, expected_len, &by_fast));
+    CHECK(memcmp(&by_nanopb, &by_fast, sizeof(by_fast)) == 0);
+}
+
+static void check_log_control(const LogControl *data)
+{
+    uint8_t expected[LogControl_size], actual[LogControl_size];
+
+    pb_ostream_t stream = pb_ostream_from_buffer(expected, sizeof(expected));
+    CHECK(pb_encode(&stream, LogControl_fields, data));
+    size_t expected_len = stream.bytes_written;
+
+    size_t actual_len = sizeof(actual);
+    CHECK(encodeLogControlFast(actual, &actual_len, data));
+    CHECK(actual_len == expected_len && memcmp(actual, expected, expected_len) == 0);
+
+    LogControl by_nanopb, by_fast;
+    pb_istream_t input = pb_istream_from_buffer(expected, expected_len);
+    CHECK(pb_decode(&input, LogControl_fields, &by_nanopb));
+    CHECK(decodeLogControlFast(expected, expected_len, &by_fast));
+    CHECK(same_log_control(&by_nanopb, &by_fast));
+}
+
+// Bytes arbitrários (a maioria inválida): mesma decisão e mesmo resultado
+static void check_garbage(void)
+{
+    uint8_t buffer[24];
+    size_t len = (size_t)rand() % sizeof(buffer);
+    for (size_t i = 0; i < len; i++)
+        buffer[i] = (uint8_t)rand();
+    if (len > 0 && rand() % 2)
+        buffer[0] = (uint8_t)((rand() % 7) << 3 | (rand() % 2 ? 5 : 0)); // Tag plausível
+
+    SensorData sd_nanopb, sd_fast;
+    pb_istream_t input = pb_istream_from_buffer(buffer, len);
+    bool ok_nanopb = pb_decode(&input, SensorData_fields, &sd_nanopb);
+    bool ok_fast = decodeSensorDataFast(buffer, len, &sd_fast);
+    CHECK(ok_nanopb == ok_fast);
+    if (ok_nanopb && ok_fast)
+        CHECK(memcmp(&sd_nanopb, &sd_fast, sizeof(sd_fast)) == 0);
+
+    LogControl lc_nanopb, lc_fast;
+    input = pb_istream_from_buffer(buffer, len);
+    ok_nanopb = pb_decode(&input, LogControl_fields, &lc_nanopb);
+    ok_fast = decodeLogControlFast(buffer, len, &lc_fast);
+    CHECK(ok_nanopb == ok_fast);
+    if (ok_nanopb && ok_fast)
+        CHECK(same_log_control(&lc_nanopb, &lc_fast));
+}
+
+int main(void)
+{
+    srand(1);
+
+    for (int i = 0; i < CODEC_ITERATIONS && test_failures < 20; i++)
+    {
+        SensorData data = {
+            .timestamp = rand() % 5 == 0 ? 0 : rand_varint64(),
+            .temperature = rand_float_bits(),
+            .humidity = rand_float_bits(),
+        };
+        check_sensor_data(&data);
+
+        LogControl control = {
+            .command = (LogControl_Command)(rand() % _LogControl_Command_ARRAYSIZE),
+            .length = rand() % 3 ? rand32() >> (rand() % 32) : 0,
+            .from_seq = rand() % 4 ? rand32() : 0,
+            .from_time = rand() % 5 ? rand_varint64() : 0,
+            .to_time = rand() % 6 ? rand_varint64() : 0,
+        };
+        check_log_control(&control);
+
+        check_garbage();
+    }
+
+    return test_result("serial_codec");
+}
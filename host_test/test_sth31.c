@@ -0,0 +1,84 @@
+// ==========================
+// Driver STH31 sobre o barramento I2C simulado
+// ==========================
+// Conversão das leituras, validação do CRC-8, novas tentativas após erro de
+// CRC ou NACK e os comandos dos modos single shot e periódico.
+#include "sth31d.h"
+#include "fake_host.h"
+#include "test_util.h"
+#include "esp_log.h"
+#include <math.h>
+
+#define STH31_ATTEMPTS 3 // STH31_MAX_RETRIES + 1 em sth31d.c
+
+static void check_reading(float expected_temp, float expected_hum)
+{
+    float temp = 0, hum = 0;
+    CHECK(sth31_get_temp_hum(&temp, &hum) == ESP_OK);
+    CHECK(fabsf(temp - expected_temp) < 0.01f);
+    CHECK(fabsf(hum - expected_hum) < 0.01f);
+}
+
+static void test_single_shot(void)
+{
+    fake_sth31_set_raw(0x6666, 0x8000);
+    check_reading(-45.0f + 175.0f * (0x6666 / 65535.0f), 100.0f * (0x8000 / 65535.0f));
+    CHECK(fake_sth31_last_command() == 0x2400); // Single shot, repetibilidade alta
+
+    sth31_set_repeatability(STH31_REPEATABILITY_LOW);
+    fake_sth31_set_raw(0x0000, 0xFFFF);
+    check_reading(-45.0f, 100.0f);
+    CHECK(fake_sth31_last_command() == 0x2416);
+    sth31_set_repeatability(STH31_REPEATABILITY_HIGH);
+}
+
+static void test_retries(void)
+{
+    sth31_stats_t before, after;
+    sth31_get_stats(&before);
+
+    // Um CRC inválido e um NACK: a leitura sai na tentativa seguinte
+    fake_sth31_corrupt_reads(1);
+    check_reading(-45.0f, 100.0f);
+    fake_sth31_nack_reads(1);
+    check_reading(-45.0f, 100.0f);
+
+    sth31_get_stats(&after);
+    CHECK(after.crc_errors == before.crc_errors + 1);
+    CHECK(after.i2c_errors == before.i2c_errors + 1);
+    CHECK(after.retries == before.retries + 2);
+    CHECK(after.reads_ok == before.reads_ok + 2);
+
+    // Todas as tentativas com erro: a leitura é descartada
+    float temp, hum;
+    fake_sth31_corrupt_reads(STH31_ATTEMPTS);
+    CHECK(sth31_get_temp_hum(&temp, &hum) == ESP_ERR_INVALID_CRC);
+    sth31_get_stats(&after);
+    CHECK(after.failures == before.failures + 1);
+}
+
+static void test_periodic(void)
+{
+    CHECK(sth31_start_periodic(STH31_MPS_10, STH31_REPEATABILITY_HIGH) == ESP_OK);
+    CHECK(sth31_is_periodic());
+    CHECK(fake_sth31_last_command() == 0x2737);
+
+    fake_sth31_set_raw(0x6666, 0x8000);
+    check_reading(-45.0f + 175.0f * (0x6666 / 65535.0f), 100.0f * (0x8000 / 65535.0f));
+    CHECK(fake_sth31_last_command() == 0xE000); // Fetch Data
+
+    CHECK(sth31_stop_periodic() == ESP_OK);
+    CHECK(!sth31_is_periodic());
+    CHECK(fake_sth31_last_command() == 0x3093); // Break
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE); // Erros de leitura são provocados
+
+    test_single_shot();
+    test_retries();
+    test_periodic();
+
+    return test_result("sth31");
+}
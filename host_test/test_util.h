@@ -0,0 +1,24 @@
+#pragma once
+
+// Verificações dos testes no host: falhas são contadas e impressas; o main
+// retorna test_result() para o ctest.
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                                               \
+    do                                                                                            \
+    {                                                                                             \
+        if (!(cond))                                                                              \
+        {                                                                                         \
+            test_failures++;                                                                      \
+            fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);                    \
+        }                                                                                         \
+    } while (0)
+
+static inline int test_result(const char *name)
+{
+    fprintf(stderr, "%s: %s (%d falhas)\n", name, test_failures ? "FALHOU" : "ok", test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+#include "ble_adv.h"
+#include "ble_gatt.h"
+#include "ble_live.h"
+#include "serial.h"
+#include "nvs_controller.h"
+
+static const char *TAG = "BLE_ADV";
+
+// Modo beacon: service data do advertising (little-endian)
+//   [0..1]  UUID 0x1809
+//   [2]     versão do formato
+//   [3..4]  temperatura, int16 em centésimos de °C
+//   [5..6]  umidade, uint16 em centésimos de %UR
+//   [7]     bateria em % (0xFF = não medida)
+//   [8..11] seq do log (próximo registro, contando o buffer de gravação), uint32
+#define BEACON_DATA_VERSION 0x01
+#define BEACON_DATA_LEN 12
+#define BEACON_BATTERY_UNKNOWN 0xFF // Não há medição de bateria no hardware atual
+
+#if CONFIG_BT_NIMBLE_EXT_ADV
+#define ADV_INSTANCE_CONN 0     // Conjunto conectável, em PDUs legados
+#define ADV_INSTANCE_PERIODIC 1 // Conjunto não conectável que carrega o periódico
+#define ADV_LEGACY_DATA_MAX 31  // Advertising/scan response legados
+#define ADV_PERIODIC_DATA_MAX 254 // Uma estrutura AD (comprimento em 1 byte)
+#endif
+
+static ble_gap_event_fn *adv_gap_event_cb = NULL;
+static struct ble_npl_event adv_refresh_event;
+static bool adv_refresh_ready = false;
+
+// ==============================
+// Payload
+// ==============================
+static size_t build_beacon_data(uint8_t *buf) {
+    SensorData sample = SensorData_init_zero;
+    ble_live_get_sample(&sample);
+
+    int32_t temp = quantizeCenti(sample.temperature);
+    int32_t hum = quantizeCenti(sample.humidity);
+    if (temp > INT16_MAX) temp = INT16_MAX;
+    if (temp < INT16_MIN) temp = INT16_MIN;
+    if (hum > UINT16_MAX) hum = UINT16_MAX;
+    if (hum < 0) hum = 0;
+
+    uint32_t seq = nvs_log_end_seq();
+
+    buf[0] = (uint8_t)BLE_SVC_UUID;
+    buf[1] = (uint8_t)(BLE_SVC_UUID >> 8);
+    buf[2] = BEACON_DATA_VERSION;
+    buf[3] = (uint8_t)temp;
+    buf[4] = (uint8_t)((uint16_t)temp >> 8);
+    buf[5] = (uint8_t)hum;
+    buf[6] = (uint8_t)(hum >> 8);
+    buf[7] = BEACON_BATTERY_UNKNOWN;
+    buf[8] = (uint8_t)seq;
+    buf[9] = (uint8_t)(seq >> 8);
+    buf[10] = (uint8_t)(seq >> 16);
+    buf[11] = (uint8_t)(seq >> 24);
+    return BEACON_DATA_LEN;
+}
+
+// Campos comuns: flags, serviço e (no modo beacon) as leituras
+static void adv_fields_init(struct ble_hs_adv_fields *fields, uint8_t *beacon_data) {
+    static const ble_uuid16_t svc_uuid = {.u = {.type = BLE_UUID_TYPE_16}, .value = BLE_SVC_UUID};
+
+    memset(fields, 0, sizeof(*fields));
+    fields->flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+
+    fields->uuids16 = &svc_uuid;
+    fields->num_uuids16 = 1;
+    fields->uuids16_is_complete = 1;
+
+    if (beacon_mode) {
+        fields->svc_data_uuid16 = beacon_data;
+        fields->svc_data_uuid16_len = build_beacon_data(beacon_data);
+    }
+}
+
+static void adv_fields_set_name(struct ble_hs_adv_fields *fields) {
+    fields->name = (uint8_t *)BLE_DEVICE_NAME;
+    fields->name_len = strlen(BLE_DEVICE_NAME);
+    fields->name_is_complete = 1;
+}
+
+// Payload do conjunto conectável (PDUs legados). No modo beacon as leituras
+// ocupam o advertising e o nome vai para a scan response (não cabem juntos em
+// 31 bytes).
+static void adv_conn_fields(struct ble_hs_adv_fields *fields, struct ble_hs_adv_fields *rsp_fields,
+                            uint8_t *beacon_data) {
+    adv_fields_init(fields, beacon_data);
+    memset(rsp_fields, 0, sizeof(*rsp_fields));
+    adv_fields_set_name(beacon_mode ? rsp_fields : fields);
+}
+
+#if CONFIG_BT_NIMBLE_EXT_ADV
+// ==============================
+// Advertising estendido (BLE 5)
+// ==============================
+// O conjunto conectável continua em PDUs legados (scannable, nome na scan
+// response): o scan padrão do Android só reporta advertising legado e centrais
+// BLE 4.x não veem PDUs estendidos. O advertising estendido/periódico fica só
+// no conjunto extra do modo beacon.
+static int adv_conn_set_data(const struct ble_hs_adv_fields *fields, bool rsp) {
+    uint8_t buf[ADV_LEGACY_DATA_MAX];
+    uint8_t len = 0;
+
+    int rc = ble_hs_adv_set_fields(fields, buf, &len, sizeof(buf));
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao montar %s; rc=%d", rsp ? "scan response" : "advertising", rc);
+        return rc;
+    }
+
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(buf, len);
+    if (!om) return BLE_HS_ENOMEM;
+
+    rc = rsp ? ble_gap_ext_adv_rsp_set_data(ADV_INSTANCE_CONN, om) : ble_gap_ext_adv_set_data(ADV_INSTANCE_CONN, om);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao definir %s; rc=%d", rsp ? "scan response" : "advertising", rc);
+    }
+    return rc;
+}
+
+static int adv_conn_set_payload(void) {
+    struct ble_hs_adv_fields fields;
+    struct ble_hs_adv_fields rsp_fields;
+    uint8_t beacon_data[BEACON_DATA_LEN];
+
+    adv_conn_fields(&fields, &rsp_fields, beacon_data);
+
+    int rc = adv_conn_set_data(&fields, false);
+    if (rc == 0) rc = adv_conn_set_data(&rsp_fields, true);
+    return rc;
+}
+
+// Últimas amostras do log como SensorDataBatch em service data 0x1809
+static int adv_periodic_set_payload(void) {
+    static SensorData window[BLE_ADV_PERIODIC_WINDOW];
+    static uint32_t window_seqs[BLE_ADV_PERIODIC_WINDOW];
+    static uint8_t buf[ADV_PERIODIC_DATA_MAX + 1];
+
+    // Inclui as amostras ainda no buffer de gravação, como o GETLENGTH e o seq do beacon
+    size_t count = 0;
+    nvs_log_read_recent(window, window_seqs, BLE_ADV_PERIODIC_WINDOW, &count);
+
+    // [comprimento][0x16][UUID][SensorDataBatch]
+    size_t len = ADV_PERIODIC_DATA_MAX - 3;
+    size_t packed = 0;
+    // Se não couber tudo, mantém as mais recentes
+    size_t skip = 0;
+    while (count > skip) {
+        len = ADV_PERIODIC_DATA_MAX - 3;
+        packed = serializeSensorDataBatch(&buf[4], &len, &window[skip], &window_seqs[skip], count - skip,
+                                          (uint32_t)interval);
+        if (packed == 0 || packed == count - skip)
+            break;
+        skip = count - packed;
+    }
+    if (packed == 0) len = 0;
+
+    buf[0] = (uint8_t)(len + 3);
+    buf[1] = BLE_HS_ADV_TYPE_SVC_DATA_UUID16;
+    buf[2] = (uint8_t)BLE_SVC_UUID;
+    buf[3] = (uint8_t)(BLE_SVC_UUID >> 8);
+
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(buf, len + 4);
+    if (!om) return BLE_HS_ENOMEM;
+
+#if CONFIG_BT_NIMBLE_PERIODIC_ADV_ENH
+    struct ble_gap_periodic_adv_set_data_params data_params = {0};
+    int rc = ble_gap_periodic_adv_set_data(ADV_INSTANCE_PERIODIC, om, &data_params);
+#else
+    int rc = ble_gap_periodic_adv_set_data(ADV_INSTANCE_PERIODIC, om);
+#endif
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ble_gap_periodic_adv_set_data; rc=%d", rc);
+    }
+    return rc;
+}
+
+static void adv_periodic_start(void) {
+    if (ble_gap_ext_adv_active(ADV_INSTANCE_PERIODIC)) return;
+
+    // Conjunto não conectável e não escaneável: só anuncia o trem periódico
+    struct ble_gap_ext_adv_params params = {0};
+    params.own_addr_type = own_addr_type;
+    params.primary_phy = BLE_HCI_LE_PHY_1M;
+    params.secondary_phy = BLE_HCI_LE_PHY_1M;
+    params.sid = ADV_INSTANCE_PERIODIC;
+    params.tx_power = 127;
+    params.itvl_min = BLE_GAP_ADV_ITVL_MS(1000);
+    params.itvl_max = BLE_GAP_ADV_ITVL_MS(1000);
+
+    int rc = ble_gap_ext_adv_configure(ADV_INSTANCE_PERIODIC, &params, NULL, NULL, NULL);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao configurar conjunto periódico; rc=%d", rc);
+        return;
+    }
+
+    struct ble_gap_periodic_adv_params pparams = {0};
+    pparams.itvl_min = BLE_GAP_PERIODIC_ITVL_MS(BLE_ADV_PERIODIC_ITVL_MS);
+    pparams.itvl_max = BLE_GAP_PERIODIC_ITVL_MS(BLE_ADV_PERIODIC_ITVL_MS);
+
+    rc = ble_gap_periodic_adv_configure(ADV_INSTANCE_PERIODIC, &pparams);
+    if (rc == 0) rc = adv_periodic_set_payload();
+#if CONFIG_BT_NIMBLE_PERIODIC_ADV_ENH
+    struct ble_gap_periodic_adv_start_params start_params = {0};
+    if (rc == 0) rc = ble_gap_periodic_adv_start(ADV_INSTANCE_PERIODIC, &start_params);
+#else
+    if (rc == 0) rc = ble_gap_periodic_adv_start(ADV_INSTANCE_PERIODIC);
+#endif
+    if (rc == 0) rc = ble_gap_ext_adv_start(ADV_INSTANCE_PERIODIC, 0, 0);
+
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao iniciar advertising periódico; rc=%d", rc);
+    } else {
+        ESP_LOGI(TAG, "Advertising periódico iniciado");
+    }
+}
+
+static void adv_periodic_stop(void) {
+    if (!ble_gap_ext_adv_active(ADV_INSTANCE_PERIODIC)) return;
+
+    ble_gap_periodic_adv_stop(ADV_INSTANCE_PERIODIC);
+    ble_gap_ext_adv_stop(ADV_INSTANCE_PERIODIC);
+    ESP_LOGI(TAG, "Advertising periódico parado");
+}
+
+void ble_adv_start(void) {
+    if (beacon_mode) adv_periodic_start();
+
+    if (ble_gap_ext_adv_active(ADV_INSTANCE_CONN)) return;
+
+    struct ble_gap_ext_adv_params params = {0};
+    params.connectable = 1;
+    params.scannable = 1;
+    params.legacy_pdu = 1;
+    params.own_addr_type = own_addr_type;
+    params.primary_phy = BLE_HCI_LE_PHY_1M;
+    params.secondary_phy = BLE_HCI_LE_PHY_1M;
+    params.sid = ADV_INSTANCE_CONN;
+    params.tx_power = 127;
+
+    int rc = ble_gap_ext_adv_configure(ADV_INSTANCE_CONN, &params, NULL, adv_gap_event_cb, NULL);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ble_gap_ext_adv_configure; rc=%d", rc);
+        return;
+    }
+
+    if (adv_conn_set_payload() != 0) return;
+
+    rc = ble_gap_ext_adv_start(ADV_INSTANCE_CONN, 0, 0);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao iniciar advertising; rc=%d", rc);
+    } else {
+        ESP_LOGI(TAG, "Advertising iniciado");
+    }
+}
+
+void ble_adv_refresh(void) {
+    if (!ble_hs_synced()) return;
+
+    adv_conn_set_payload();
+
+    if (beacon_mode) {
+        if (ble_gap_ext_adv_active(ADV_INSTANCE_PERIODIC))
+            adv_periodic_set_payload();
+        else
+            adv_periodic_start();
+    } else {
+        adv_periodic_stop();
+    }
+}
+
+#else
+// ==============================
+// Advertising legado
+// ==============================
+static int adv_legacy_set_payload(void) {
+    struct ble_hs_adv_fields fields;
+    struct ble_hs_adv_fields rsp_fields;
+    uint8_t beacon_data[BEACON_DATA_LEN];
+
+    adv_conn_fields(&fields, &rsp_fields, beacon_data);
+
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ble_gap_adv_set_fields; rc=%d", rc);
+        return rc;
+    }
+
+    rc = ble_gap_adv_rsp_set_fields(&rsp_fields);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ble_gap_adv_rsp_set_fields; rc=%d", rc);
+    }
+    return rc;
+}
+
+void ble_adv_start(void) {
+    struct ble_gap_adv_params adv_params = {0};
+
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+
+    if (adv_legacy_set_payload() != 0) {
+        return;
+    }
+
+    int rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER,
+                               &adv_params, adv_gap_event_cb, NULL);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Erro ao iniciar advertising; rc=%d", rc);
+    } else {
+        ESP_LOGI(TAG, "Advertising iniciado");
+    }
+}
+
+// Atualiza o payload sem reiniciar o advertising
+void ble_adv_refresh(void) {
+    if (!ble_hs_synced()) return;
+    adv_legacy_set_payload();
+}
+#endif
+
+// ==============================
+// Atualização a partir da amostragem
+// ==============================
+static void adv_refresh_event_cb(struct ble_npl_event *ev) {
+    ble_adv_refresh();
+}
+
+void ble_post_adv_refresh(void) {
+    if (!adv_refresh_ready || !beacon_mode) return;
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &adv_refresh_event);
+}
+
+void ble_adv_init(ble_gap_event_fn *gap_event_cb) {
+    adv_gap_event_cb = gap_event_cb;
+    ble_npl_event_init(&adv_refresh_event, adv_refresh_event_cb, NULL);
+    adv_refresh_ready = true;
+}
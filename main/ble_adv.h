@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host/ble_gap.h"
+
+// ==========================
+// Advertising
+// ==========================
+// O advertising conectável é sempre legado (visível a qualquer central). Com
+// CONFIG_BT_NIMBLE_EXT_ADV, no modo beacon, um segundo conjunto (estendido)
+// envia por advertising periódico as últimas BLE_ADV_PERIODIC_WINDOW amostras
+// (SensorDataBatch), para que um scanner recupere falhas curtas sem conectar.
+
+#define BLE_DEVICE_NAME "Beacon_ESP32"
+#define BLE_SVC_UUID 0x1809
+
+#define BLE_ADV_PERIODIC_WINDOW 32    // Amostras no advertising periódico
+#define BLE_ADV_PERIODIC_ITVL_MS 1000 // Intervalo do advertising periódico
+
+// Registra o callback de eventos GAP das conexões aceitas pelo advertising
+void ble_adv_init(ble_gap_event_fn *gap_event_cb);
+
+// Inicia (ou retoma) o advertising conectável
+void ble_adv_start(void);
+
+// Atualiza o advertising com a última leitura (modo beacon)
+void ble_adv_refresh(void);
+
+// Agenda ble_adv_refresh() na task do host NimBLE (chamável de outras tasks)
+void ble_post_adv_refresh(void);
@@ -0,0 +1,346 @@
+#include "ble_coc.h"
+#include "ble_gatt.h"
+#include "ble_live.h"
+#include "serial.h"
+#include "nvs_controller.h"
+#include "ble_sync.h"
+#include "host/ble_l2cap.h"
+#include <string.h>
+
+static const char *TAG = "BLE_COC";
+
+// Nova tentativa caso falte mbuf para montar o SDU ou os registros ainda
+// estejam sendo gravados
+#define COC_RETRY_MS 10
+
+// Registros mantidos em RAM para montar os lotes (limite do SensorDataBatch)
+#define COC_READ_CHUNK 64
+
+// Estado do canal e da exportação (sempre no contexto do host NimBLE)
+static struct ble_l2cap_chan *coc_chan = NULL;
+static uint16_t coc_sdu_size = 0;
+static bool coc_active = false;
+static bool coc_stalled = false; // Sem créditos: aguarda TX_UNSTALLED
+static bool coc_end_sent = false;
+static uint32_t coc_sent = 0;
+static nvs_log_cursor_t coc_cursor;
+static struct ble_npl_callout coc_retry;
+
+static SensorData coc_chunk[COC_READ_CHUNK];
+static uint32_t coc_seqs[COC_READ_CHUNK];
+static size_t coc_chunk_pos = 0;
+static size_t coc_chunk_len = 0;
+
+static uint8_t coc_sdu[LOG_COC_SDU_MAX];
+static size_t coc_pending_len = 0;      // SDU montado e ainda não aceito
+static uint32_t coc_pending_records = 0; // Registros desse SDU
+
+// ==========================
+// Montagem dos SDUs
+// ==========================
+static void coc_fill_chunk(void)
+{
+    if (coc_chunk_pos > 0)
+    {
+        memmove(coc_chunk, &coc_chunk[coc_chunk_pos], (coc_chunk_len - coc_chunk_pos) * sizeof(coc_chunk[0]));
+        memmove(coc_seqs, &coc_seqs[coc_chunk_pos], (coc_chunk_len - coc_chunk_pos) * sizeof(coc_seqs[0]));
+        coc_chunk_len -= coc_chunk_pos;
+        coc_chunk_pos = 0;
+    }
+
+    while (coc_chunk_len < COC_READ_CHUNK && !nvs_log_cursor_done(&coc_cursor))
+    {
+        size_t read = 0;
+        esp_err_t err = nvs_log_cursor_next(&coc_cursor, &coc_chunk[coc_chunk_len], &coc_seqs[coc_chunk_len],
+                                            COC_READ_CHUNK - coc_chunk_len, &read);
+        if (err == ESP_ERR_NOT_FINISHED)
+            break; // Próximos registros ainda no buffer de gravação
+        if (err != ESP_OK || read == 0)
+        {
+            nvs_log_cursor_close(&coc_cursor);
+            break;
+        }
+        coc_chunk_len += read;
+    }
+}
+
+// Enche o SDU com lotes [tamanho varint][SensorDataBatch]; ao esgotar o log,
+// acrescenta o lote vazio de fim de fluxo. Retorna o tamanho do SDU (0 se os
+// próximos registros ainda estão sendo gravados).
+static size_t coc_build_sdu(void)
+{
+    size_t used = 0;
+
+    for (;;)
+    {
+        coc_fill_chunk();
+        if (coc_chunk_len == 0)
+        {
+            // Registros ainda no buffer de gravação: o fim de fluxo fica para depois
+            if (!nvs_log_cursor_done(&coc_cursor))
+                return used;
+            break;
+        }
+
+        // Lote de até SensorDataBatch_size bytes: prefixo de no máximo 2 bytes
+        if (coc_sdu_size - used < 3)
+            return used;
+
+        size_t len = coc_sdu_size - used - 2;
+        size_t records = serializeSensorDataBatch(&coc_sdu[used + 2], &len, coc_chunk, coc_seqs, coc_chunk_len,
+                                                  (uint32_t)interval);
+        if (records == 0)
+            return used;
+
+        if (len < 0x80)
+        {
+            coc_sdu[used] = (uint8_t)len;
+            memmove(&coc_sdu[used + 1], &coc_sdu[used + 2], len);
+            used += 1 + len;
+        }
+        else
+        {
+            coc_sdu[used] = (uint8_t)(len | 0x80);
+            coc_sdu[used + 1] = (uint8_t)(len >> 7);
+            used += 2 + len;
+        }
+
+        coc_chunk_pos = records;
+        coc_pending_records += records;
+    }
+
+    // Fim do log: lote vazio
+    if (used < coc_sdu_size)
+    {
+        coc_sdu[used++] = 0;
+        coc_end_sent = true;
+    }
+    return used;
+}
+
+// ==========================
+// Envio
+// ==========================
+static void coc_finish(void)
+{
+    coc_active = false;
+    coc_stalled = false;
+    coc_end_sent = false;
+    coc_pending_len = 0;
+    coc_pending_records = 0;
+    coc_chunk_pos = 0;
+    coc_chunk_len = 0;
+    nvs_log_cursor_close(&coc_cursor);
+    ble_npl_callout_stop(&coc_retry);
+    ble_link_set_fast(false);
+}
+
+static void coc_pump(void)
+{
+    while (coc_active && !coc_stalled && (coc_pending_len > 0 || !coc_end_sent))
+    {
+        // SDU não aceito (sem mbuf ou canal ocupado) fica guardado e é reenviado
+        if (coc_pending_len == 0)
+            coc_pending_len = coc_build_sdu();
+        if (coc_pending_len == 0)
+        {
+            ble_npl_callout_reset(&coc_retry, ble_npl_time_ms_to_ticks32(COC_RETRY_MS));
+            return;
+        }
+
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(coc_sdu, coc_pending_len);
+        if (!om)
+        {
+            ble_npl_callout_reset(&coc_retry, ble_npl_time_ms_to_ticks32(COC_RETRY_MS));
+            return;
+        }
+
+        int rc = ble_l2cap_send(coc_chan, om);
+        if (rc == BLE_HS_EBUSY)
+        {
+            // SDU anterior ainda na fila do canal: o SDU não foi aceito e
+            // continua montado para a próxima tentativa
+            os_mbuf_free_chain(om);
+            ble_npl_callout_reset(&coc_retry, ble_npl_time_ms_to_ticks32(COC_RETRY_MS));
+            return;
+        }
+        if (rc != 0 && rc != BLE_HS_ESTALLED && rc != BLE_HS_ENOMEM)
+        {
+            os_mbuf_free_chain(om);
+            ESP_LOGE(TAG, "Erro ao enviar SDU (rc=%d), exportação interrompida", rc);
+            coc_finish();
+            return;
+        }
+
+        // SDU aceito: a partir daqui o mbuf pertence ao canal
+        coc_sent += coc_pending_records;
+        coc_pending_records = 0;
+        coc_pending_len = 0;
+
+        if (rc == BLE_HS_ENOMEM)
+        {
+            // Já na fila do canal, mas sem mbuf para os fragmentos: o envio
+            // continua com os próximos créditos; o próximo SDU espera com
+            // EBUSY pelo callout
+            ble_npl_callout_reset(&coc_retry, ble_npl_time_ms_to_ticks32(COC_RETRY_MS));
+            return;
+        }
+
+        // Com ESTALLED não há créditos até TX_UNSTALLED
+        if (rc == BLE_HS_ESTALLED)
+            coc_stalled = true;
+    }
+
+    if (coc_active && coc_end_sent && coc_pending_len == 0 && !coc_stalled)
+    {
+        ESP_LOGI(TAG, "Exportação concluída: %lu registros", (unsigned long)coc_sent);
+        coc_finish();
+    }
+}
+
+static void coc_retry_cb(struct ble_npl_event *ev)
+{
+    coc_pump();
+}
+
+static void coc_start(const LogControl *command)
+{
+    coc_finish();
+
+    nvs_log_cursor_open_range(&coc_cursor, command->from_seq, command->from_time, command->to_time);
+    coc_sent = 0;
+    coc_active = true;
+    ble_link_set_fast(true);
+
+    ESP_LOGI(TAG, "Exportação iniciada: %lu registros, SDU de %u bytes",
+             (unsigned long)(coc_cursor.end_seq - coc_cursor.next_seq), coc_sdu_size);
+    coc_pump();
+}
+
+// ==========================
+// Comandos recebidos pelo canal
+// ==========================
+static void coc_handle_sdu(struct os_mbuf *sdu)
+{
+    uint8_t buf[LOG_COC_RX_MTU];
+    uint16_t len = OS_MBUF_PKTLEN(sdu);
+    if (len > sizeof(buf))
+        len = sizeof(buf);
+    os_mbuf_copydata(sdu, 0, len, buf);
+
+    LogControl command;
+    if (!deserializeLogControl(buf, len, &command))
+    {
+        ESP_LOGE(TAG, "Erro ao decodificar comando LogControl");
+        return;
+    }
+
+    switch (command.command)
+    {
+    case LogControl_Command_RESUME:
+        ble_sync_require_bond();
+        if (ble_sync_watermark() > command.from_seq)
+            command.from_seq = ble_sync_watermark();
+        coc_start(&command);
+        break;
+
+    case LogControl_Command_START:
+        coc_start(&command);
+        break;
+
+    case LogControl_Command_ACK:
+        ble_sync_require_bond();
+        ble_sync_ack(command.from_seq);
+        break;
+
+    case LogControl_Command_STOP:
+        if (coc_active)
+            ESP_LOGI(TAG, "Exportação interrompida (%lu registros enviados)", (unsigned long)coc_sent);
+        coc_finish();
+        ble_sync_flush();
+        break;
+
+    default:
+        ESP_LOGW(TAG, "Comando não suportado no canal: %d", command.command);
+        break;
+    }
+}
+
+static void coc_recv_ready(struct ble_l2cap_chan *chan)
+{
+    struct os_mbuf *sdu_rx = os_msys_get_pkthdr(LOG_COC_RX_MTU, 0);
+    if (!sdu_rx || ble_l2cap_recv_ready(chan, sdu_rx) != 0)
+    {
+        ESP_LOGE(TAG, "Sem buffer para receber comandos no canal");
+        if (sdu_rx)
+            os_mbuf_free_chain(sdu_rx);
+    }
+}
+
+// ==========================
+// Eventos L2CAP
+// ==========================
+static int coc_event_cb(struct ble_l2cap_event *event, void *arg)
+{
+    switch (event->type)
+    {
+    case BLE_L2CAP_EVENT_COC_ACCEPT:
+        // Um canal por vez
+        if (coc_chan)
+            return BLE_HS_EBUSY;
+        coc_recv_ready(event->accept.chan);
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_CONNECTED:
+    {
+        if (event->connect.status != 0)
+        {
+            ESP_LOGW(TAG, "Falha ao abrir canal; status=%d", event->connect.status);
+            return 0;
+        }
+
+        struct ble_l2cap_chan_info info;
+        coc_chan = event->connect.chan;
+        coc_sdu_size = LOG_COC_SDU_MAX;
+        if (ble_l2cap_get_chan_info(coc_chan, &info) == 0 && info.peer_coc_mtu < coc_sdu_size)
+            coc_sdu_size = info.peer_coc_mtu;
+
+        ESP_LOGI(TAG, "Canal aberto (SDU de até %u bytes)", coc_sdu_size);
+        return 0;
+    }
+
+    case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        coc_finish();
+        coc_chan = NULL;
+        ESP_LOGI(TAG, "Canal fechado");
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        if (event->receive.sdu_rx)
+        {
+            coc_handle_sdu(event->receive.sdu_rx);
+            os_mbuf_free_chain(event->receive.sdu_rx);
+        }
+        coc_recv_ready(event->receive.chan);
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+        coc_stalled = false;
+        coc_pump();
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+void ble_coc_init(void)
+{
+    ble_npl_callout_init(&coc_retry, nimble_port_get_dflt_eventq(), coc_retry_cb, NULL);
+
+    int rc = ble_l2cap_create_server(LOG_COC_PSM, LOG_COC_RX_MTU, coc_event_cb, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(TAG, "Erro ao criar servidor L2CAP (rc=%d)", rc);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ==========================
+// Exportação do log por canal L2CAP orientado a conexão (LE CoC)
+// ==========================
+// O cliente abre um canal no PSM LOG_COC_PSM e envia um LogControl START; o
+// log segue como fluxo contínuo de SDUs de até LOG_COC_SDU_MAX bytes, com o
+// controle de fluxo por créditos do próprio L2CAP. Cada SDU é uma sequência
+// de SensorDataBatch prefixados pelo tamanho (varint); um lote vazio
+// (tamanho 0) marca o fim. STOP interrompe o envio.
+//
+// O GATT (ble_log) continua disponível para controle e compatibilidade.
+
+#define LOG_COC_PSM 0x0080     // PSM dinâmico LE
+#define LOG_COC_RX_MTU 64      // Maior SDU recebido (comandos LogControl)
+#define LOG_COC_SDU_MAX 2048   // Maior SDU enviado (limitado também pelo MTU do cliente)
+
+void ble_coc_init(void);
@@ -2,22 +2,49 @@
 #include "ble_live.h"
 #include "ble_log.h"
 #include "temp_hum.h"
+#include "ble_adv.h"
+#include "ble_coc.h"
+#include "ble_sync.h"
 
 static const char *TAG = "BLE_GATT";
 
+void ble_store_config_init(void);
+
+// ==============================
+// Parâmetros de enlace
+// ==============================
+// Durante o download do log: intervalo curto, PHY 2M e PDUs de 251 bytes.
+// Fora dele volta a um intervalo longo com latência de periférico. O PHY 2M e
+// o DLE são mantidos (menos tempo de rádio por byte também economiza energia).
+#define CONN_FAST_ITVL_MIN 6          // 7,5 ms (unidades de 1,25 ms)
+#define CONN_FAST_ITVL_MAX 12         // 15 ms
+#define CONN_FAST_LATENCY 0
+#define CONN_IDLE_ITVL_MIN 80         // 100 ms
+#define CONN_IDLE_ITVL_MAX 160        // 200 ms
+#define CONN_IDLE_LATENCY 4
+#define CONN_SUPERVISION_TIMEOUT 600  // 6 s (unidades de 10 ms)
+#define CONN_IDLE_DELAY_MS 2000       // Espera antes de voltar ao modo econômico
+#define CONN_MAX_TX_OCTETS 251
+#define CONN_MAX_TX_TIME 2120         // us para 251 bytes no PHY 1M
+#define ATT_PREFERRED_MTU 247         // Notificação de 244 bytes em um PDU de 251
+
 // ==============================
 // Variáveis BLE
 // ==============================
 uint8_t own_addr_type;
 uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
-static void ble_app_advertise(void);
+
+static bool link_fast = false;     // Parâmetros de download solicitados
+static bool link_radio_set = false; // PHY 2M e DLE já solicitados nesta conexão
+static bool mtu_exchanged = false; // Troca de MTU já iniciada nesta conexão
+static struct ble_npl_callout link_idle_timer;
 
 // ==============================
 // Serviço GATT
 // ==============================
 static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
     {.type = BLE_GATT_SVC_TYPE_PRIMARY,
-     .uuid = BLE_UUID16_DECLARE(0x1809),
+     .uuid = BLE_UUID16_DECLARE(BLE_SVC_UUID),
      .characteristics = (struct ble_gatt_chr_def[]){
          {
              .uuid = BLE_UUID16_DECLARE(0x2A1C),
@@ -48,6 +75,84 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
     {0},
 };
 
+// ==============================
+// Enlace rápido durante transferências
+// ==============================
+static int mtu_exchange_cb(uint16_t conn, const struct ble_gatt_error *error, uint16_t mtu, void *arg) {
+    if (error->status == 0) {
+        ESP_LOGI(TAG, "MTU negociado: %u", mtu);
+    } else {
+        ESP_LOGW(TAG, "Falha na troca de MTU; status=%u", error->status);
+    }
+    return 0;
+}
+
+static void link_request_params(bool fast) {
+    struct ble_gap_upd_params params = {
+        .itvl_min = fast ? CONN_FAST_ITVL_MIN : CONN_IDLE_ITVL_MIN,
+        .itvl_max = fast ? CONN_FAST_ITVL_MAX : CONN_IDLE_ITVL_MAX,
+        .latency = fast ? CONN_FAST_LATENCY : CONN_IDLE_LATENCY,
+        .supervision_timeout = CONN_SUPERVISION_TIMEOUT,
+    };
+
+    int rc = ble_gap_update_params(conn_handle, &params);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Erro ao solicitar parâmetros de conexão; rc=%d", rc);
+    }
+}
+
+static void link_idle_timer_cb(struct ble_npl_event *ev) {
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE || link_fast) return;
+    link_request_params(false);
+}
+
+void ble_link_set_fast(bool fast) {
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) return;
+
+    if (!fast) {
+        // Adia a volta ao modo econômico: downloads seguidos não renegociam
+        if (link_fast) {
+            link_fast = false;
+            ble_npl_callout_reset(&link_idle_timer, ble_npl_time_ms_to_ticks32(CONN_IDLE_DELAY_MS));
+        }
+        return;
+    }
+
+    // Volta ao modo econômico ainda pendente: o enlace continua rápido e
+    // basta cancelá-la (ex.: START logo após o transfer_reset de outro START)
+    bool revert_pending = ble_npl_callout_is_active(&link_idle_timer);
+    ble_npl_callout_stop(&link_idle_timer);
+    if (link_fast) return;
+    link_fast = true;
+    if (revert_pending) return;
+
+    // PHY e DLE não são revertidos: uma vez por conexão
+    if (!link_radio_set) {
+        link_radio_set = true;
+
+        int rc = ble_gap_set_prefered_le_phy(conn_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                             BLE_GAP_LE_PHY_CODED_ANY);
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Erro ao solicitar PHY 2M; rc=%d", rc);
+        }
+
+        rc = ble_gap_set_data_len(conn_handle, CONN_MAX_TX_OCTETS, CONN_MAX_TX_TIME);
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Erro ao solicitar data length; rc=%d", rc);
+        }
+    }
+
+    if (!mtu_exchanged) {
+        mtu_exchanged = true;
+        int rc = ble_gattc_exchange_mtu(conn_handle, mtu_exchange_cb, NULL);
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Erro ao iniciar troca de MTU; rc=%d", rc);
+        }
+    }
+
+    link_request_params(true);
+}
+
 // ==============================
 // GAP Events
 // ==============================
@@ -57,69 +162,106 @@ static int ble_gap_event_cb(struct ble_gap_event *event, void *arg) {
         if (event->connect.status == 0) {
             conn_handle = event->connect.conn_handle;
             ESP_LOGI(TAG, "Dispositivo conectado.");
+            ble_sync_peer_connected(conn_handle);
+
+            // Cliente já pareado: reativa a criptografia para recuperar a
+            // identidade e a marca de sincronização. Clientes novos só pareiam
+            // ao usar RESUME/ACK (ble_sync_require_bond).
+            struct ble_gap_conn_desc desc;
+            struct ble_store_key_sec key = {0};
+            struct ble_store_value_sec bond;
+            if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+                key.peer_addr = desc.peer_id_addr;
+                if (ble_store_read_peer_sec(&key, &bond) == 0) {
+                    int rc = ble_gap_security_initiate(conn_handle);
+                    if (rc != 0) {
+                        ESP_LOGW(TAG, "Erro ao iniciar segurança; rc=%d", rc);
+                    }
+                }
+            }
         } else {
             ESP_LOGI(TAG, "Falha na conexão. Status=%d", event->connect.status);
-            ble_app_advertise();
+            ble_adv_start();
         }
         break;
 
     case BLE_GAP_EVENT_DISCONNECT:
         conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        link_fast = false;
+        link_radio_set = false;
+        mtu_exchanged = false;
+        ble_npl_callout_stop(&link_idle_timer);
+        ble_log_on_disconnect();
+        ble_sync_peer_disconnected();
         ESP_LOGI(TAG, "Dispositivo desconectado.");
-        ble_app_advertise();
+        ble_adv_start();
         break;
 
-    case BLE_GAP_EVENT_ADV_COMPLETE:
-        ESP_LOGI(TAG, "Advertising completo.");
-        ble_app_advertise();
+    case BLE_GAP_EVENT_ENC_CHANGE:
+        // Com bond, o endereço de identidade do cliente é conhecido a partir daqui
+        if (event->enc_change.status == 0)
+            ble_sync_peer_connected(event->enc_change.conn_handle);
+        else
+            ESP_LOGW(TAG, "Criptografia falhou; status=%d", event->enc_change.status);
         break;
 
-    default:
-        break;
+    case BLE_GAP_EVENT_REPEAT_PAIRING: {
+        // Cliente perdeu o bond e pareia de novo: descarta o bond antigo
+        struct ble_gap_conn_desc desc;
+        if (ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc) == 0)
+            ble_store_util_delete_peer(&desc.peer_id_addr);
+        return BLE_GAP_REPEAT_PAIRING_RETRY;
     }
 
-    return 0;
-}
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        if (event->notify_tx.attr_handle == log_char_handle) {
+            log_stream_resume();
+        }
+        break;
 
-// ==============================
-// Advertising
-// ==============================
-static void ble_app_advertise(void) {
-    struct ble_gap_adv_params adv_params = {0};
+    case BLE_GAP_EVENT_CONN_UPDATE: {
+        struct ble_gap_conn_desc desc;
+        if (event->conn_update.status == 0 && ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0) {
+            ESP_LOGI(TAG, "Conexão atualizada: intervalo %u x 1,25 ms, latência %u, timeout %u x 10 ms",
+                     desc.conn_itvl, desc.conn_latency, desc.supervision_timeout);
+        } else {
+            ESP_LOGW(TAG, "Atualização de conexão falhou; status=%d", event->conn_update.status);
+        }
+        break;
+    }
 
-    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
-    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        ESP_LOGI(TAG, "PHY atualizado: status=%d tx=%u rx=%u", event->phy_updated.status,
+                 event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        break;
 
-    struct ble_hs_adv_fields fields;
-    memset(&fields, 0, sizeof(fields));
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+    case BLE_GAP_EVENT_DATA_LEN_CHG:
+        ESP_LOGI(TAG, "Data length: tx %u bytes/%u us, rx %u bytes/%u us",
+                 event->data_len_chg.max_tx_octets, event->data_len_chg.max_tx_time,
+                 event->data_len_chg.max_rx_octets, event->data_len_chg.max_rx_time);
+        break;
+#endif
 
-    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
-    fields.name = (uint8_t *)"Beacon_ESP32";
-    fields.name_len = strlen("Beacon_ESP32");
-    fields.name_is_complete = 1;
+    case BLE_GAP_EVENT_MTU:
+        ESP_LOGI(TAG, "MTU atualizado: %u", event->mtu.value);
+        break;
 
-    const uint16_t svc_uuid = 0x1809;
-    fields.uuids16 = (ble_uuid16_t[]){
-        {.u = {.type = BLE_UUID_TYPE_16}, .value = svc_uuid}};
-    fields.num_uuids16 = 1;
-    fields.uuids16_is_complete = 1;
+    case BLE_GAP_EVENT_ADV_COMPLETE:
+        ESP_LOGI(TAG, "Advertising completo.");
+        // No advertising estendido o evento também chega quando a conexão é aceita
+        if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            ble_adv_start();
+        }
+        break;
 
-    int rc = ble_gap_adv_set_fields(&fields);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Erro ble_gap_adv_set_fields; rc=%d", rc);
-        return;
+    default:
+        break;
     }
 
-    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER,
-                           &adv_params, ble_gap_event_cb, NULL);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Erro ao iniciar advertising; rc=%d", rc);
-    } else {
-        ESP_LOGI(TAG, "Advertising iniciado");
-    }
+    return 0;
 }
 
-
 // ==============================
 // Sync Callback
 // ==============================
@@ -134,7 +276,7 @@ static void ble_on_sync(void) {
              addr_val[5], addr_val[4], addr_val[3],
              addr_val[2], addr_val[1], addr_val[0]);
 
-    ble_app_advertise();
+    ble_adv_start();
 }
 
 
@@ -146,11 +288,26 @@ void ble_init(void) {
 
     ble_svc_gap_init();
     ble_svc_gatt_init();
+    ble_live_init();
+    ble_adv_init(ble_gap_event_cb);
+    ble_coc_init();
+    ble_npl_callout_init(&link_idle_timer, nimble_port_get_dflt_eventq(), link_idle_timer_cb, NULL);
+    ble_att_set_preferred_mtu(ATT_PREFERRED_MTU);
 
     ble_gatts_count_cfg(gatt_svr_svcs);
     ble_gatts_add_svcs(gatt_svr_svcs);
 
     ble_hs_cfg.sync_cb = ble_on_sync;
+
+    // Bonding (sem E/S): o cliente é reconhecido pelo endereço de identidade
+    // em reconexões, o que permite retomar downloads (ble_sync)
+    ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
+    ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_NO_IO;
+    ble_hs_cfg.sm_bonding = 1;
+    ble_hs_cfg.sm_sc = 1;
+    ble_hs_cfg.sm_our_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_store_config_init();
 }
 
 void ble_start(void) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -16,5 +17,7 @@ extern uint8_t own_addr_type;
 extern uint16_t conn_handle;
 
 void ble_init(void);
+// Enlace rápido (PHY 2M, DLE, MTU e intervalo curto) durante transferências
+void ble_link_set_fast(bool fast);
 void ble_start(void);
 void ble_host_task(void *param);
\ No newline at end of file
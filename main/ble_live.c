@@ -1,9 +1,12 @@
 #include "ble_live.h"
 #include "ble_gatt.h"
+#include "ble_adv.h"
 #include "ble_log.h"
 #include "temp_hum.h"
 #include "serial.h"
 #include "nvs_controller.h"
+#include "freertos/FreeRTOS.h"
+#include <stdatomic.h>
 
 static const char *TAG = "BLE_LIVE";
 
@@ -11,26 +14,103 @@ uint64_t interval;
 uint64_t log_mode = 1; //Always
 uint16_t date_time_init = 0;
 uint16_t date_time_stop = 0;
+SensorConfig_Repeatability repeatability = SensorConfig_Repeatability_HIGH;
+bool beacon_mode = false;
 
 uint16_t temp_char_handle;
 uint16_t config_char_handle;
 
+static struct ble_npl_event notify_sensor_event;
+
+// ==============================
+// Última amostra (payload SensorData já codificado)
+// ==============================
+// Escrita pela task do sensor e lida pela task do host NimBLE. Protegida por
+// um contador de versão (seqlock): ímpar durante a escrita; o leitor repete a
+// cópia se a versão mudou, então nunca entrega um payload pela metade. A escrita
+// é feita em seção crítica: com um só núcleo, o host (prioridade maior) não pode
+// preemptar o escritor com a versão ímpar e ficar girando no leitor.
+typedef struct
+{
+    uint32_t sample_seq; // Número da amostra (0 = nenhuma ainda)
+    SensorData sample;
+    uint8_t len;
+    uint8_t payload[SensorData_size];
+} live_payload_t;
+
+static _Atomic uint32_t live_version = 0;
+static live_payload_t live_payload;
+static portMUX_TYPE live_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t live_notified_seq = 0; // Última amostra notificada (task do host)
+
+void ble_live_publish_sample(const SensorData *sample) {
+    live_payload_t next;
+    size_t len = sizeof(next.payload);
+
+    if (!serializeSensorDataFromStruct(next.payload, &len, sample)) return;
+    next.len = (uint8_t)len;
+    next.sample = *sample;
+    next.sample_seq = live_payload.sample_seq + 1; // Só esta task escreve
+
+    portENTER_CRITICAL(&live_mux);
+    uint32_t v = atomic_load_explicit(&live_version, memory_order_relaxed);
+    atomic_store_explicit(&live_version, v + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    live_payload = next;
+    atomic_store_explicit(&live_version, v + 2, memory_order_release);
+    portEXIT_CRITICAL(&live_mux);
+}
+
+static void live_snapshot(live_payload_t *out) {
+    uint32_t v1, v2;
+    do {
+        v1 = atomic_load_explicit(&live_version, memory_order_acquire);
+        *out = live_payload;
+        atomic_thread_fence(memory_order_acquire);
+        v2 = atomic_load_explicit(&live_version, memory_order_relaxed);
+    } while (v1 != v2 || (v1 & 1));
+}
+
 
 // ==============================
 // Notify BLE
 // ==============================
+static void notify_sensor_event_cb(struct ble_npl_event *ev) {
+    ble_notify_sensor();
+}
+
+void ble_live_init(void) {
+    ble_npl_event_init(&notify_sensor_event, notify_sensor_event_cb, NULL);
+}
+
+void ble_post_notify_sensor(void) {
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) return;
+
+    // Evento já na fila não é enfileirado de novo
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &notify_sensor_event);
+}
+
+bool ble_live_get_sample(SensorData *sample) {
+    live_payload_t snap;
+    live_snapshot(&snap);
+    *sample = snap.sample;
+    return snap.sample_seq != 0;
+}
+
 void ble_notify_sensor(void) {
     if (conn_handle == BLE_HS_CONN_HANDLE_NONE) return;
 
-    uint8_t buffer[64];
-    size_t len = sizeof(buffer);
+    live_payload_t snap;
+    live_snapshot(&snap);
 
-    if (serializeSensorData(buffer, &len, get_temperature(), get_humidity())) {
-        struct os_mbuf *om = ble_hs_mbuf_from_flat(buffer, len);
-        if (om) {
-            ble_gattc_notify_custom(conn_handle, temp_char_handle, om);
-            ESP_LOGI(TAG, "Notify Temp/Hum enviado");
-        }
+    // Cada amostra é notificada uma vez
+    if (snap.sample_seq == 0 || snap.sample_seq == live_notified_seq) return;
+
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(snap.payload, snap.len);
+    if (om) {
+        if (ble_gattc_notify_custom(conn_handle, temp_char_handle, om) == 0)
+            live_notified_seq = snap.sample_seq;
+        ESP_LOGI(TAG, "Notify Temp/Hum enviado");
     }
 }
 
@@ -43,6 +123,8 @@ void ble_notify_config(void) {
     cfg.log_mode = log_mode;
     cfg.date_time_init = date_time_init;
     cfg.date_time_stop = date_time_stop;
+    cfg.repeatability = repeatability;
+    cfg.beacon = beacon_mode;
 
     uint8_t buffer[64];
     size_t len = sizeof(buffer);
@@ -70,12 +152,13 @@ int gatt_svr_access_cb(
     size_t len = sizeof(buffer);
 
     if (attr_handle == temp_char_handle) {
-        if (serializeSensorData(buffer, &len, get_temperature(), get_humidity())) {
-            os_mbuf_append(ctxt->om, buffer, len);
-            ESP_LOGI(TAG, "Read Temp/Hum");
-            return 0;
-        }
-        return BLE_ATT_ERR_UNLIKELY;
+        // Mesma amostra (e timestamp) da última notificação
+        live_payload_t snap;
+        live_snapshot(&snap);
+        if (os_mbuf_append(ctxt->om, snap.payload, snap.len) != 0)
+            return BLE_ATT_ERR_INSUFFICIENT_RES;
+        ESP_LOGI(TAG, "Read Temp/Hum");
+        return 0;
     }
 
     if (attr_handle == config_char_handle) {
@@ -86,6 +169,8 @@ int gatt_svr_access_cb(
             cfg.log_mode = log_mode;
             cfg.date_time_init = date_time_init;
             cfg.date_time_stop = date_time_stop;
+            cfg.repeatability = repeatability;
+            cfg.beacon = beacon_mode;
 
             if (serializeSensorConfig(buffer, &len, &cfg)) {
                 os_mbuf_append(ctxt->om, buffer, len);
@@ -107,15 +192,19 @@ int gatt_svr_access_cb(
                 log_mode = data.log_mode;
                 date_time_init = data.date_time_init;
                 date_time_stop = data.date_time_stop;
+                repeatability = data.repeatability;
+                beacon_mode = data.beacon;
 
                 nvs_save_sensor_config(&data); // Salva o que recebeu
+                temp_hum_apply_config(interval);
+                ble_adv_refresh();
 
                 ESP_LOGI(TAG, 
-                    "Configurações atualizadas via BLE:\nInterval: %llu\nLog_mode: %d\nDate_time_init: %llu\nDate_time_stop: %llu", 
-                    interval, 
-                    log_mode, 
-                    date_time_init, 
-                    date_time_stop
+                    "Configurações atualizadas via BLE:\nInterval: %llu\nLog_mode: %llu\nDate_time_init: %u\nDate_time_stop: %u", 
+                    (unsigned long long)interval, 
+                    (unsigned long long)log_mode, 
+                    (unsigned)date_time_init, 
+                    (unsigned)date_time_stop
                 );
 
                 ble_notify_config();
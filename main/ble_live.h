@@ -13,6 +13,7 @@
 #include "host/ble_gap.h"
 #include "services/gap/ble_svc_gap.h"
 #include "services/gatt/ble_svc_gatt.h"
+#include "sensor.pb.h"
 
 
 
@@ -20,10 +21,19 @@ extern uint64_t interval;
 extern uint64_t log_mode; //Always
 extern uint16_t date_time_init;
 extern uint16_t date_time_stop;
+extern SensorConfig_Repeatability repeatability;
+extern bool beacon_mode;
 
 extern uint16_t temp_char_handle;
 extern uint16_t config_char_handle;
 
+void ble_live_init(void);
+// Codifica a amostra uma única vez; notify e leitura GATT servem esse payload
+void ble_live_publish_sample(const SensorData *sample);
+// Última amostra publicada; false se ainda não houve nenhuma
+bool ble_live_get_sample(SensorData *sample);
 void ble_notify_sensor(void);
+// Agenda ble_notify_sensor() na task do host NimBLE (chamável de outras tasks)
+void ble_post_notify_sensor(void);
 void ble_notify_config(void);
 int gatt_svr_access_cb(uint16_t conn, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg);
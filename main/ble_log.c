@@ -2,33 +2,63 @@
 #include "ble_log.h"
 #include "serial.h"
 #include "nvs_controller.h"
+#include "ble_live.h"
+#include "ble_sync.h"
+#include <string.h>
 
 
 static const char *TAG = "BLE_LOG";
 
+// Maior payload de notificação que cabe em um PDU de enlace de 251 bytes
+#define LOG_NOTIFY_MAX_PAYLOAD 244
+
+// Nova tentativa de envio após falta de mbufs (caso nenhum NOTIFY_TX chegue) ou
+// enquanto os registros ainda estão no buffer de gravação
+#define LOG_RETRY_MS 10
+
+// Registros mantidos em RAM para montar os lotes (limite do SensorDataBatch)
+#define LOG_READ_CHUNK 64
+
 // Handles BLE
 uint16_t log_char_handle;
 uint16_t log_ctrl_char_handle;
 
 // Controle interno
 bool transfer_active = false;
-static size_t transfer_index = 0;
-static size_t transfer_total = 0;
-static SensorData *log_data_array = NULL;
+static size_t transfer_index = 0; // Registros já enviados
+static size_t transfer_total = 0; // Registros no log na abertura do cursor (limite superior com faixa de tempo)
+static size_t transfer_last = 0;  // Registros enviados na última transferência encerrada
+static nvs_log_cursor_t log_cursor;
+
+// Registros lidos do cursor e ainda não empacotados ([chunk_pos, chunk_len))
+static SensorData read_chunk[LOG_READ_CHUNK];
+static uint32_t read_seqs[LOG_READ_CHUNK];
+static size_t chunk_pos = 0;
+static size_t chunk_len = 0;
+
+// Lote montado e ainda não aceito pela pilha (reenviado após BLE_HS_ENOMEM)
+static uint8_t frame[LOG_NOTIFY_MAX_PAYLOAD];
+static size_t frame_len = 0;
+static size_t frame_records = 0;
+
+// Streaming com créditos
+static bool stream_mode = false;
+static uint32_t stream_credits = 0;
+static bool stream_stalled = false; // Aguardando mbufs livres ou gravação (BLE_HS_ENOMEM/EAGAIN)
+static bool stream_pumping = false; // Evita reentrada via NOTIFY_TX síncrono
+static bool next_pending = false;   // Lote de START/NEXT adiado (modo sem créditos)
+static struct ble_npl_callout log_retry;
+static bool log_retry_ready = false;
 
 // ==========================
-// Envia um LogControl serializado com a quantidade de dados
+// Envia um LogControl serializado (resposta/estado no canal de controle)
 // ==========================
-static int notify_log_control_count(uint32_t count)
+static int notify_log_control(LogControl_Command command, uint32_t value)
 {
-    LogControl response = LogControl_init_zero;
-    response.command = LogControl_Command_GETLENGTH;
-    response.length = count;
-
     uint8_t buffer[64];
     size_t len = sizeof(buffer);
 
-    if (!serializeLogControl(buffer, &len, response.command, response.length))
+    if (!serializeLogControl(buffer, &len, command, value))
     {
         ESP_LOGE(TAG, "Falha ao serializar LogControl");
         return -1;
@@ -51,43 +81,241 @@ static int notify_log_control_count(uint32_t count)
 }
 
 // ==========================
-// Envia o próximo dado SensorData via notify
+// Monta o próximo lote a partir do cursor
 // ==========================
-static int send_next_log_entry()
+// Cada notificação é um SensorDataBatch com quantos registros couberem no
+// MTU negociado; first_seq permite ao app retomar a sincronização dali.
+static bool build_next_frame(void)
 {
-    if (!log_data_array || transfer_index >= transfer_total)
+    size_t capacity = ble_att_mtu(conn_handle) - 3; // Cabeçalho ATT da notificação
+    if (capacity > sizeof(frame))
+        capacity = sizeof(frame);
+
+    // Completa o buffer de leitura com os próximos registros do cursor
+    if (chunk_pos > 0)
     {
-        ESP_LOGW(TAG, "Nenhum dado para enviar ou todos os dados já foram enviados.");
-        return -1;
+        memmove(read_chunk, &read_chunk[chunk_pos], (chunk_len - chunk_pos) * sizeof(read_chunk[0]));
+        memmove(read_seqs, &read_seqs[chunk_pos], (chunk_len - chunk_pos) * sizeof(read_seqs[0]));
+        chunk_len -= chunk_pos;
+        chunk_pos = 0;
+    }
+    while (chunk_len < LOG_READ_CHUNK && !nvs_log_cursor_done(&log_cursor))
+    {
+        size_t read = 0;
+        esp_err_t err = nvs_log_cursor_next(&log_cursor, &read_chunk[chunk_len], &read_seqs[chunk_len],
+                                            LOG_READ_CHUNK - chunk_len, &read);
+        if (err == ESP_ERR_NOT_FINISHED)
+            break; // Próximos registros ainda no buffer de gravação
+        if (err != ESP_OK || read == 0)
+        {
+            // Fim do que existe no log (ex.: apagado durante a leitura)
+            nvs_log_cursor_close(&log_cursor);
+            break;
+        }
+        chunk_len += read;
     }
 
-    uint8_t buffer[64];
-    size_t len = sizeof(buffer);
+    if (chunk_len == 0)
+        return false;
 
-    if (!serializeSensorDataFromStruct(buffer, &len, &log_data_array[transfer_index]))
+    size_t len = capacity;
+    size_t records = serializeSensorDataBatch(frame, &len, read_chunk, read_seqs, chunk_len, (uint32_t)interval);
+    if (records == 0)
     {
-        ESP_LOGE(TAG, "Falha ao serializar SensorData existente");
+        ESP_LOGE(TAG, "Registro não cabe no MTU atual (%u)", ble_att_mtu(conn_handle));
+        return false;
+    }
+
+    chunk_pos = records;
+    frame_len = len;
+    frame_records = records;
+    return true;
+}
+
+static bool transfer_has_more(void)
+{
+    return frame_len > 0 || chunk_pos < chunk_len || !nvs_log_cursor_done(&log_cursor);
+}
+
+// ==========================
+// Envia o próximo lote de SensorData via notify
+// ==========================
+// Retorna BLE_HS_ENOMEM se a pilha estiver sem mbufs; nesse caso o lote
+// fica guardado e é reenviado na próxima chamada. BLE_HS_EAGAIN: os próximos
+// registros ainda não estão na flash. BLE_HS_EMSGSIZE indica que o próximo
+// registro não cabe no MTU: a transferência não tem como avançar.
+static int send_next_log_batch()
+{
+    if (frame_len == 0 && !build_next_frame())
+    {
+        // Há registros, mas nem um cabe no MTU atual
+        if (chunk_len > chunk_pos)
+            return BLE_HS_EMSGSIZE;
+
+        // Registros ainda sendo gravados pela task de gravação
+        if (!nvs_log_cursor_done(&log_cursor))
+            return BLE_HS_EAGAIN;
+
+        ESP_LOGW(TAG, "Nenhum dado para enviar ou todos os dados já foram enviados.");
         return -1;
     }
 
-    struct os_mbuf *om = ble_hs_mbuf_from_flat(buffer, len);
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(frame, frame_len);
     if (!om)
     {
-        ESP_LOGE(TAG, "Erro ao criar os_mbuf");
-        return -1;
+        return BLE_HS_ENOMEM;
     }
 
     int rc = ble_gattc_notify_custom(conn_handle, log_char_handle, om);
     if (rc != 0)
     {
-        ESP_LOGE(TAG, "Erro ao enviar log (rc=%d)", rc);
+        if (rc != BLE_HS_ENOMEM)
+            ESP_LOGE(TAG, "Erro ao enviar log (rc=%d)", rc);
         return rc;
     }
 
-    transfer_index++; // Avança para o próximo
+    transfer_index += frame_records; // Avança para o próximo lote
+    frame_len = 0;
+    frame_records = 0;
     return 0;
 }
 
+// ==========================
+// Encerra a transferência
+// ==========================
+static void transfer_reset(void)
+{
+    if (transfer_active)
+        transfer_last = transfer_index;
+    transfer_active = false;
+    transfer_index = 0;
+    transfer_total = 0;
+    stream_mode = false;
+    stream_credits = 0;
+    stream_stalled = false;
+    next_pending = false;
+    if (log_retry_ready)
+        ble_npl_callout_stop(&log_retry);
+
+    nvs_log_cursor_close(&log_cursor);
+    ble_link_set_fast(false);
+    chunk_pos = 0;
+    chunk_len = 0;
+    frame_len = 0;
+    frame_records = 0;
+}
+
+static void log_retry_cb(struct ble_npl_event *ev);
+
+static void log_retry_arm(void)
+{
+    if (!log_retry_ready)
+    {
+        ble_npl_callout_init(&log_retry, nimble_port_get_dflt_eventq(), log_retry_cb, NULL);
+        log_retry_ready = true;
+    }
+    ble_npl_callout_reset(&log_retry, ble_npl_time_ms_to_ticks32(LOG_RETRY_MS));
+}
+
+// Aborta a transferência avisando o cliente (STOP com o total já enviado)
+static void transfer_abort(void)
+{
+    ESP_LOGE(TAG, "Transferência abortada após %u registros.", (unsigned)transfer_index);
+    notify_log_control(LogControl_Command_STOP, transfer_index);
+    transfer_reset();
+}
+
+// Fim do log: STOP com o total enviado (o transfer_total não é exato com faixa de tempo)
+static void transfer_finish(void)
+{
+    ESP_LOGI(TAG, "Transferência concluída: %u registros enviados.", (unsigned)transfer_index);
+    notify_log_control(LogControl_Command_STOP, transfer_index);
+    transfer_reset();
+}
+
+// Modo sem créditos (START/NEXT): um lote por pedido, adiado se não puder sair agora
+static void send_requested_batch(void)
+{
+    int rc = send_next_log_batch();
+    if (rc == BLE_HS_EMSGSIZE)
+    {
+        transfer_abort();
+    }
+    else if (rc == BLE_HS_ENOMEM || rc == BLE_HS_EAGAIN)
+    {
+        next_pending = true;
+        log_retry_arm();
+    }
+    else if (transfer_active && !transfer_has_more())
+    {
+        transfer_finish();
+    }
+}
+
+// ==========================
+// Streaming: envia lotes em sequência enquanto houver créditos
+// ==========================
+// Roda sempre no contexto do host NimBLE (callback GATT, evento GAP ou callout).
+static void log_stream_pump(void)
+{
+    if (stream_pumping)
+        return;
+    stream_pumping = true;
+    stream_stalled = false;
+
+    while (transfer_active && stream_credits > 0 && transfer_has_more())
+    {
+        int rc = send_next_log_batch();
+        if (rc == BLE_HS_ENOMEM || rc == BLE_HS_EAGAIN)
+        {
+            // Sem buffers ou registros ainda em gravação: retoma no próximo
+            // NOTIFY_TX ou no callout
+            stream_stalled = true;
+            log_retry_arm();
+            break;
+        }
+        if (rc != 0)
+        {
+            ESP_LOGE(TAG, "Streaming interrompido (rc=%d)", rc);
+            transfer_abort();
+            break;
+        }
+        stream_credits--;
+    }
+
+    stream_pumping = false;
+
+    if (transfer_active && !transfer_has_more())
+        transfer_finish();
+}
+
+static void log_retry_cb(struct ble_npl_event *ev)
+{
+    if (stream_stalled)
+    {
+        log_stream_pump();
+    }
+    else if (next_pending)
+    {
+        next_pending = false;
+        send_requested_batch();
+    }
+}
+
+void log_stream_resume(void)
+{
+    if (stream_mode && stream_stalled)
+        log_stream_pump();
+}
+
+void ble_log_on_disconnect(void)
+{
+    if (transfer_active)
+        ESP_LOGI(TAG, "Conexão perdida durante a transferência (%u de %u registros).",
+                 (unsigned)transfer_index, (unsigned)transfer_total);
+    transfer_reset();
+}
+
 // ==========================
 // Manipulador da característica de controle
 // ==========================
@@ -109,31 +337,31 @@ int log_gatt_access_cb(uint16_t conn_handle_cb, uint16_t attr_handle,
         {
             uint32_t count = 0;
             nvs_get_sensor_data_count(&count);
-            notify_log_control_count(count);
+            notify_log_control(LogControl_Command_GETLENGTH, count);
             break;
         }
 
+        case LogControl_Command_RESUME:
+            // Retoma de onde o cliente parou (marca d'água da última sessão)
+            ble_sync_require_bond();
+            if (ble_sync_watermark() > command.from_seq)
+                command.from_seq = ble_sync_watermark();
+            /* fall through */
+
         case LogControl_Command_START:
         {
-            if (log_data_array)
-                free(log_data_array);
-
-            uint32_t count = 0;
-            nvs_get_sensor_data_count(&count);
-            transfer_total = count;
+            transfer_reset();
 
-            log_data_array = calloc(transfer_total, sizeof(SensorData));
-            if (!log_data_array)
-            {
-                ESP_LOGE(TAG, "Erro ao alocar memória para logs");
-                return BLE_ATT_ERR_INSUFFICIENT_RES;
-            }
-
-            nvs_read_all_sensor_data(log_data_array, transfer_total, &transfer_total);
+            // Sem faixa, o log inteiro; com faixa, só os registros novos/no intervalo
+            nvs_log_cursor_open_range(&log_cursor, command.from_seq, command.from_time, command.to_time);
+            transfer_total = log_cursor.end_seq - log_cursor.next_seq;
             transfer_index = 0;
             transfer_active = true;
+            ble_link_set_fast(true);
+            ESP_LOGI(TAG, "Transferência iniciada: %u registros (seq %lu a %lu).", (unsigned)transfer_total,
+                     (unsigned long)log_cursor.next_seq, (unsigned long)log_cursor.end_seq);
 
-            send_next_log_entry();
+            send_requested_batch();
             break;
         }
 
@@ -141,49 +369,57 @@ int log_gatt_access_cb(uint16_t conn_handle_cb, uint16_t attr_handle,
         {
             if (transfer_active)
             {
-                if (transfer_index < transfer_total)
-                {
-                    send_next_log_entry();
-                }
-                else
-                {
-                    ESP_LOGI(TAG, "Todos os dados foram enviados.");
-                }
+                send_requested_batch();
+            }
+            else
+            {
+                // Transferência já concluída: repete o STOP para o cliente saber
+                ESP_LOGI(TAG, "Todos os dados foram enviados.");
+                notify_log_control(LogControl_Command_STOP, transfer_last);
             }
             break;
         }
 
-        case LogControl_Command_STOP:
+        case LogControl_Command_CREDIT:
         {
-            transfer_active = false;
-            transfer_index = 0;
-            transfer_total = 0;
-            if (log_data_array)
+            if (!transfer_active)
             {
-                free(log_data_array);
-                log_data_array = NULL;
+                ESP_LOGW(TAG, "Créditos recebidos sem transferência ativa.");
+                break;
             }
 
+            stream_mode = true;
+            next_pending = false;
+            stream_credits += command.length;
+            log_stream_pump();
+            break;
+        }
+
+        case LogControl_Command_ACK:
+        {
+            ble_sync_require_bond();
+            ble_sync_ack(command.from_seq);
+            break;
+        }
+
+        case LogControl_Command_STOP:
+        {
+            transfer_reset();
+            ble_sync_flush();
+
             ESP_LOGI(TAG, "Transferência interrompida.");
-            
+
             break;
         }
 
 
         case LogControl_Command_CLEAR:
         {
-            transfer_active = false;
-            transfer_index = 0;
-            transfer_total = 0;
-            if (log_data_array)
-            {
-                free(log_data_array);
-                log_data_array = NULL;
-            }
-           
+            transfer_reset();
+
             nvs_clear_all_sensor_data();
-            ESP_LOGI(TAG, "Todos os logs foram apagados.");
-            
+            ESP_LOGI(TAG, "Apagamento dos logs solicitado.");
+
             break;
         }
 
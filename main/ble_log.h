@@ -16,3 +16,9 @@ extern bool transfer_active;
 // Callback BLE para característica de controle de log
 int log_gatt_access_cb(uint16_t conn_handle_cb, uint16_t attr_handle,
                        struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+// Retoma o streaming de log após falta de buffers (chamado em BLE_GAP_EVENT_NOTIFY_TX)
+void log_stream_resume(void);
+
+// Encerra a transferência em andamento (chamado em BLE_GAP_EVENT_DISCONNECT)
+void ble_log_on_disconnect(void);
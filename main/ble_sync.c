@@ -0,0 +1,130 @@
+#include "ble_sync.h"
+#include "ble_gatt.h"
+#include "nvs_controller.h"
+#include "log_store.h"
+
+static const char *TAG = "BLE_SYNC";
+
+// Estado do cliente conectado (sempre no contexto do host NimBLE)
+static bool peer_valid = false;       // Identidade estável: marca persistida
+static uint8_t peer_addr[6];
+static uint32_t watermark = 0;
+static uint32_t persisted_watermark = 0;
+static bool bond_requested = false;   // Pareamento já pedido nesta conexão
+
+// ==========================
+// Identidade do peer
+// ==========================
+// Endereços aleatórios resolvíveis/não resolvíveis mudam a cada conexão; sem
+// bond não há como reconhecer o cliente depois, e a marca não é persistida.
+static bool peer_identity(uint16_t handle, uint8_t addr[6])
+{
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(handle, &desc) != 0)
+        return false;
+
+    const ble_addr_t *id = &desc.peer_id_addr;
+    bool stable = desc.sec_state.bonded || id->type == BLE_ADDR_PUBLIC ||
+                  (id->type == BLE_ADDR_RANDOM && (id->val[5] & 0xC0) == 0xC0);
+    if (!stable)
+        return false;
+
+    memcpy(addr, id->val, sizeof(id->val));
+    return true;
+}
+
+// ==========================
+// Eventos de conexão
+// ==========================
+// Chamado na conexão e a cada mudança de criptografia: com um bond, o
+// endereço de identidade só é conhecido depois da criptografia.
+void ble_sync_peer_connected(uint16_t conn_handle)
+{
+    uint8_t addr[6];
+    if (!peer_identity(conn_handle, addr))
+    {
+        if (!peer_valid)
+            watermark = persisted_watermark = 0;
+        return;
+    }
+
+    if (peer_valid && memcmp(addr, peer_addr, sizeof(addr)) == 0)
+        return;
+
+    // ACKs recebidos antes da identidade ser conhecida valem para este cliente
+    uint32_t stored = 0;
+    nvs_load_sync_watermark(addr, &stored);
+    if (peer_valid || stored > watermark)
+        watermark = stored;
+    persisted_watermark = stored;
+
+    memcpy(peer_addr, addr, sizeof(addr));
+    peer_valid = true;
+
+    ESP_LOGI(TAG, "Cliente %02X:%02X:%02X:%02X:%02X:%02X, marca de sincronização em seq %lu",
+             addr[5], addr[4], addr[3], addr[2], addr[1], addr[0], (unsigned long)watermark);
+}
+
+void ble_sync_peer_disconnected(void)
+{
+    ble_sync_flush();
+    peer_valid = false;
+    bond_requested = false;
+    watermark = persisted_watermark = 0;
+}
+
+// Só clientes que usam a marca persistida são pareados: o pareamento Just Works
+// pode abrir um aviso do sistema no celular e ocupa uma entrada no bond store.
+// O bond conclui em ENC_CHANGE, que chama ble_sync_peer_connected de novo.
+void ble_sync_require_bond(void)
+{
+    if (bond_requested || conn_handle == BLE_HS_CONN_HANDLE_NONE)
+        return;
+
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(conn_handle, &desc) != 0 || desc.sec_state.encrypted)
+        return;
+
+    bond_requested = true;
+    int rc = ble_gap_security_initiate(conn_handle);
+    if (rc != 0)
+        ESP_LOGW(TAG, "Erro ao iniciar pareamento; rc=%d", rc);
+}
+
+// ==========================
+// Marca d'água
+// ==========================
+uint32_t ble_sync_watermark(void)
+{
+    return watermark;
+}
+
+void ble_sync_ack(uint32_t next_seq)
+{
+    // Só avança, e nunca além do que existe no log
+    uint32_t newest = log_store_next_seq();
+    if (next_seq > newest)
+        next_seq = newest;
+    if (next_seq <= watermark)
+        return;
+
+    watermark = next_seq;
+
+    if (!peer_valid)
+    {
+        ESP_LOGW(TAG, "ACK de cliente sem identidade estável (sem bond), marca não persistida");
+        return;
+    }
+
+    if (watermark - persisted_watermark >= BLE_SYNC_PERSIST_RECORDS)
+        ble_sync_flush();
+}
+
+void ble_sync_flush(void)
+{
+    if (!peer_valid || watermark == persisted_watermark)
+        return;
+
+    if (nvs_save_sync_watermark(peer_addr, watermark) == ESP_OK)
+        persisted_watermark = watermark;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ==========================
+// Marca d'água de sincronização por cliente
+// ==========================
+// Para cada peer com identidade estável (bonded, ou endereço público/estático)
+// o firmware guarda o seq do próximo registro que o cliente ainda não
+// confirmou. O cliente avança a marca com LogControl ACK (from_seq = próximo
+// seq que ainda não tem) e, ao reconectar, pede RESUME em vez de START.
+//
+// A marca vive em RAM durante a conexão e só vai para a NVS quando avança
+// BLE_SYNC_PERSIST_RECORDS registros, no fim da transferência e na desconexão.
+//
+// Celulares usam endereço privado resolvível: sem bond a marca não é
+// persistida. O pareamento só é pedido quando o cliente usa RESUME ou ACK;
+// clientes que só leem os dados ao vivo não são pareados.
+
+#define BLE_SYNC_PERSIST_RECORDS 1024
+
+// Eventos de conexão (contexto do host NimBLE)
+void ble_sync_peer_connected(uint16_t conn_handle);
+void ble_sync_peer_disconnected(void);
+
+// Próximo seq ainda não confirmado pelo cliente atual (0 se desconhecido)
+uint32_t ble_sync_watermark(void);
+
+// Pede pareamento/bond ao cliente atual, uma vez por conexão, se o link ainda
+// não estiver criptografado. Chamado no RESUME e no ACK.
+void ble_sync_require_bond(void);
+
+// Confirma o recebimento de todos os registros com seq < next_seq
+void ble_sync_ack(uint32_t next_seq);
+
+// Grava a marca na NVS se ela avançou desde a última gravação
+void ble_sync_flush(void);
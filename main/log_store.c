@@ -0,0 +1,592 @@
+#include "log_store.h"
+#include "serial.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TAG "LOG_STORE"
+#define LOG_STORE_MAGIC 0x334C4F47 // "GOL3" (cabeçalho com base_seq)
+#define LOG_STORE_MAGIC_V2 0x324C4F47 // "GOL2" (mesmos registros, cabeçalho com first_seq)
+#define LOG_STORE_MAGIC_V1 0x314C4F47 // "GOL1" (registros de 24 bytes, não lido)
+#define LOG_STORE_ERASED_WORD 0xFFFFFFFF
+#define LOG_STORE_WRITE_MAX_RECORDS 16 // Registros por chamada de esp_partition_write (256 bytes na pilha)
+// log_store_prepare() abre o próximo setor quando restam menos slots livres que
+// isto: maior que um lote do buffer de gravação, para que o apagamento nunca
+// ocorra dentro de um append
+#define LOG_STORE_PREPARE_FREE 32
+
+// ==========================
+// Formato em flash
+// ==========================
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sector_seq; // Setor lógico (cresce a cada setor aberto)
+    uint32_t base_seq;   // Registros com seq menor foram apagados (clear); "GOL2": seq do 1º registro
+    uint32_t crc;        // CRC32 dos campos acima
+} log_sector_hdr_t;
+
+// Mesma quantização do SensorDataBatch: centésimos de °C / %UR
+typedef struct
+{
+    uint32_t seq;        // 0xFFFFFFFF = slot livre
+    uint32_t timestamp;  // Unix (s)
+    int16_t temperature; // centi-°C
+    uint16_t humidity;   // centi-%UR
+    uint32_t crc;        // CRC32 (semente = seq) de timestamp..humidity
+} log_record_t;
+
+_Static_assert(sizeof(log_record_t) == 16, "log_record_t deve ter 16 bytes");
+
+#define LOG_STORE_RECORDS_PER_SECTOR \
+    ((uint32_t)((LOG_STORE_SECTOR_SIZE - sizeof(log_sector_hdr_t)) / sizeof(log_record_t)))
+
+// ==========================
+// Estado em RAM
+// ==========================
+// Escritas (append/clear) são serializadas por write_lock. Leituras não usam
+// lock: leem next_seq/oldest_seq atômicos e validam cada registro por seq+CRC,
+// então nunca esperam por uma gravação ou apagamento de setor em andamento.
+static const esp_partition_t *partition = NULL;
+static uint32_t sector_count = 0;
+static _Atomic uint32_t next_seq = 0;   // Próximo seq a ser gravado
+static _Atomic uint32_t oldest_seq = 0; // Registro mais antigo ainda em flash
+static SemaphoreHandle_t write_lock = NULL;
+
+// Faixa de timestamps por setor físico, para a busca por tempo. Escrita com
+// write_lock (antes de publicar next_seq) e lida sem lock. Setores gravados
+// antes do boot começam "desconhecidos" (sempre consultados) até serem
+// indexados por log_store_index_step().
+typedef struct
+{
+    uint32_t min_ts;
+    uint32_t max_ts;
+} log_span_t;
+
+#define LOG_SPAN_UNKNOWN ((log_span_t){0, UINT32_MAX})
+#define LOG_SPAN_EMPTY ((log_span_t){UINT32_MAX, 0})
+
+static log_span_t *spans = NULL;
+static uint32_t index_next = 0; // Próximo setor físico a indexar
+
+// Clear em O(1): em vez de apagar setores, o log passa a começar em base_seq.
+// O valor é persistido no cabeçalho do próximo setor aberto; os setores antigos
+// são reaproveitados normalmente pelo wrap-around. Protegidos por write_lock.
+static uint32_t base_seq = 0;
+static uint32_t ready_sector = UINT32_MAX; // Último setor apagado e com cabeçalho gravado
+
+// ==========================
+// Auxiliares
+// ==========================
+static size_t sector_offset(uint32_t sector_seq)
+{
+    return (size_t)(sector_seq % sector_count) * LOG_STORE_SECTOR_SIZE;
+}
+
+static size_t record_offset(uint32_t seq)
+{
+    return sector_offset(seq / LOG_STORE_RECORDS_PER_SECTOR) + sizeof(log_sector_hdr_t) +
+           (size_t)(seq % LOG_STORE_RECORDS_PER_SECTOR) * sizeof(log_record_t);
+}
+
+static uint32_t header_crc(const log_sector_hdr_t *hdr)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(log_sector_hdr_t, crc));
+}
+
+static uint32_t record_crc(const log_record_t *rec)
+{
+    return esp_rom_crc32_le(rec->seq, (const uint8_t *)&rec->timestamp,
+                            offsetof(log_record_t, crc) - offsetof(log_record_t, timestamp));
+}
+
+// Lê o registro seq; retorna false se estiver livre, corrompido ou ilegível
+static bool read_record(uint32_t seq, log_record_t *rec)
+{
+    return esp_partition_read(partition, record_offset(seq), rec, sizeof(*rec)) == ESP_OK &&
+           rec->seq == seq && rec->crc == record_crc(rec);
+}
+
+// Lê o cabeçalho do setor físico idx; retorna false se o setor estiver apagado ou corrompido.
+// Cabeçalhos "GOL2" (sem clear persistido) são lidos com base_seq = 0.
+static bool read_header(uint32_t idx, log_sector_hdr_t *hdr)
+{
+    if (esp_partition_read(partition, (size_t)idx * LOG_STORE_SECTOR_SIZE, hdr, sizeof(*hdr)) != ESP_OK)
+        return false;
+
+    uint32_t first_seq = hdr->sector_seq * LOG_STORE_RECORDS_PER_SECTOR;
+    if (hdr->crc != header_crc(hdr) || hdr->sector_seq % sector_count != idx)
+        return false;
+
+    if (hdr->magic == LOG_STORE_MAGIC_V2 && hdr->base_seq == first_seq)
+    {
+        hdr->base_seq = 0;
+        return true;
+    }
+
+    return hdr->magic == LOG_STORE_MAGIC && hdr->base_seq <= first_seq;
+}
+
+// Apaga e inicializa o setor lógico sector_seq, descartando o que havia nele
+static esp_err_t open_sector(uint32_t sector_seq)
+{
+    // O setor físico reutilizado continha os registros mais antigos; eles deixam
+    // de ser visíveis antes do apagamento
+    if (sector_seq >= sector_count)
+    {
+        uint32_t min_seq = (sector_seq - sector_count + 1) * LOG_STORE_RECORDS_PER_SECTOR;
+        if (atomic_load(&oldest_seq) < min_seq)
+            atomic_store(&oldest_seq, min_seq);
+    }
+
+    spans[sector_seq % sector_count] = LOG_SPAN_EMPTY;
+
+    esp_err_t err = esp_partition_erase_range(partition, sector_offset(sector_seq), LOG_STORE_SECTOR_SIZE);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Erro ao apagar setor %lu: %s", (unsigned long)sector_seq, esp_err_to_name(err));
+        return err;
+    }
+
+    log_sector_hdr_t hdr = {
+        .magic = LOG_STORE_MAGIC,
+        .sector_seq = sector_seq,
+        .base_seq = base_seq,
+    };
+    hdr.crc = header_crc(&hdr);
+
+    err = esp_partition_write(partition, sector_offset(sector_seq), &hdr, sizeof(hdr));
+    ready_sector = err == ESP_OK ? sector_seq : UINT32_MAX;
+    return err;
+}
+
+// ==========================
+// Recuperação de head/tail no boot
+// ==========================
+// O setor lógico s fica no setor físico s % N, então em ordem física os
+// cabeçalhos válidos formam a volta corrente [0, head] (sector_seq - idx
+// constante) seguida da volta anterior, ou de setores apagados. Head, tail e o
+// primeiro slot livre saem por busca binária: O(log N + log registros) leituras,
+// independente do tamanho do log.
+static uint32_t boot_reads = 0; // Leituras de flash na recuperação (log de boot)
+
+static bool boot_read_header(uint32_t idx, log_sector_hdr_t *hdr)
+{
+    boot_reads++;
+    return read_header(idx, hdr);
+}
+
+static bool slot_used(uint32_t seq)
+{
+    uint32_t seq_word;
+    boot_reads++;
+    return esp_partition_read(partition, record_offset(seq), &seq_word, sizeof(seq_word)) == ESP_OK &&
+           seq_word != LOG_STORE_ERASED_WORD;
+}
+
+static void recover(void)
+{
+    log_sector_hdr_t hdr;
+    uint32_t first_idx; // Primeiro setor físico da volta corrente
+    uint32_t head_idx;  // Último setor físico da volta corrente (head)
+    uint32_t lap;       // sector_seq - idx na volta corrente
+
+    if (boot_read_header(0, &hdr))
+    {
+        // Último idx com cabeçalho válido e sector_seq - idx == lap
+        first_idx = 0;
+        lap = hdr.sector_seq;
+        uint32_t lo = 0, hi = sector_count - 1;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            if (boot_read_header(mid, &hdr) && hdr.sector_seq - mid == lap)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        head_idx = lo;
+    }
+    else
+    {
+        if (hdr.magic == LOG_STORE_MAGIC_V1)
+            ESP_LOGW(TAG, "Log no formato antigo (24 bytes/registro) descartado");
+
+        // Setor 0 apagado com o log em uso: a abertura dele foi interrompida e
+        // o head é o último setor físico
+        if (!boot_read_header(sector_count - 1, &hdr))
+        {
+            atomic_store(&next_seq, 0);
+            atomic_store(&oldest_seq, 0);
+            return;
+        }
+        first_idx = 1;
+        head_idx = sector_count - 1;
+        lap = hdr.sector_seq - head_idx;
+    }
+
+    uint32_t head_sector = lap + head_idx;
+    if (!boot_read_header(head_idx, &hdr))
+        hdr.base_seq = 0;
+    uint32_t head_base = hdr.base_seq;
+
+    // Tail: a volta anterior continua logo após o head (o setor seguinte pode
+    // estar apagado se a abertura foi interrompida); senão, a volta corrente
+    uint32_t tail_sector = lap + first_idx;
+    for (uint32_t k = 1; k <= 2 && head_sector + k >= sector_count; k++)
+    {
+        uint32_t sector = head_sector + k - sector_count;
+        if (sector < tail_sector && boot_read_header((head_idx + k) % sector_count, &hdr) &&
+            hdr.sector_seq == sector)
+        {
+            tail_sector = sector;
+            break;
+        }
+    }
+
+    // Primeiro slot livre no setor corrente (os slots são ocupados em ordem)
+    uint32_t lo = 0, hi = LOG_STORE_RECORDS_PER_SECTOR;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (slot_used(head_sector * LOG_STORE_RECORDS_PER_SECTOR + mid))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    uint32_t used = lo;
+
+    // Setor corrente aberto antecipadamente (log_store_prepare) e ainda vazio:
+    // a gravação continua nos slots livres do anterior, se o clear não os apagou
+    if (used == 0 && head_sector > 0 && head_base < head_sector * LOG_STORE_RECORDS_PER_SECTOR &&
+        boot_read_header((head_idx + sector_count - 1) % sector_count, &hdr) && hdr.sector_seq == head_sector - 1)
+    {
+        lo = 0;
+        hi = LOG_STORE_RECORDS_PER_SECTOR;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (slot_used((head_sector - 1) * LOG_STORE_RECORDS_PER_SECTOR + mid))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < LOG_STORE_RECORDS_PER_SECTOR)
+        {
+            head_sector--;
+            used = lo;
+        }
+    }
+
+    // O último clear persistido (cabeçalho do setor corrente) esconde o que veio antes
+    uint32_t tail_seq = tail_sector * LOG_STORE_RECORDS_PER_SECTOR;
+    base_seq = head_base;
+    ready_sector = lap + head_idx;
+    atomic_store(&next_seq, head_sector * LOG_STORE_RECORDS_PER_SECTOR + used);
+    atomic_store(&oldest_seq, base_seq > tail_seq ? base_seq : tail_seq);
+}
+
+// ==========================
+// API pública
+// ==========================
+esp_err_t log_store_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         LOG_STORE_PARTITION_LABEL);
+    if (!partition)
+    {
+        ESP_LOGE(TAG, "Partição '%s' não encontrada", LOG_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_count = partition->size / LOG_STORE_SECTOR_SIZE;
+    if (sector_count < 2)
+    {
+        ESP_LOGE(TAG, "Partição '%s' pequena demais", LOG_STORE_PARTITION_LABEL);
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    write_lock = xSemaphoreCreateMutex();
+    spans = calloc(sector_count, sizeof(spans[0]));
+    if (!write_lock || !spans)
+    {
+        partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t idx = 0; idx < sector_count; idx++)
+        spans[idx] = LOG_SPAN_UNKNOWN;
+    index_next = 0;
+
+    int64_t start_us = esp_timer_get_time();
+    boot_reads = 0;
+    recover();
+    int64_t recover_us = esp_timer_get_time() - start_us;
+
+    ESP_LOGI(TAG, "Log: %lu setores x %lu registros, seq [%lu, %lu)",
+             (unsigned long)sector_count, (unsigned long)LOG_STORE_RECORDS_PER_SECTOR,
+             (unsigned long)atomic_load(&oldest_seq), (unsigned long)atomic_load(&next_seq));
+    ESP_LOGI(TAG, "Recuperação no boot: %lld us, %lu leituras de flash", (long long)recover_us, (unsigned long)boot_reads);
+    return ESP_OK;
+}
+
+esp_err_t log_store_append(uint64_t timestamp, float temp, float hum)
+{
+    SensorData sample = {
+        .timestamp = timestamp,
+        .temperature = temp,
+        .humidity = hum,
+    };
+    return log_store_append_batch(&sample, 1);
+}
+
+esp_err_t log_store_append_batch(const SensorData *samples, size_t count)
+{
+    if (!partition)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    esp_err_t err = ESP_OK;
+    size_t done = 0;
+    while (done < count && err == ESP_OK)
+    {
+        uint32_t seq = atomic_load(&next_seq);
+        if (seq % LOG_STORE_RECORDS_PER_SECTOR == 0 && ready_sector != seq / LOG_STORE_RECORDS_PER_SECTOR)
+        {
+            err = open_sector(seq / LOG_STORE_RECORDS_PER_SECTOR);
+            if (err != ESP_OK)
+                break;
+        }
+
+        // Registros contíguos no mesmo setor: uma única gravação
+        log_record_t recs[LOG_STORE_WRITE_MAX_RECORDS];
+        size_t n = count - done;
+        if (n > LOG_STORE_WRITE_MAX_RECORDS)
+            n = LOG_STORE_WRITE_MAX_RECORDS;
+        if (n > LOG_STORE_RECORDS_PER_SECTOR - seq % LOG_STORE_RECORDS_PER_SECTOR)
+            n = LOG_STORE_RECORDS_PER_SECTOR - seq % LOG_STORE_RECORDS_PER_SECTOR;
+
+        log_span_t *span = &spans[(seq / LOG_STORE_RECORDS_PER_SECTOR) % sector_count];
+        for (size_t i = 0; i < n; i++)
+        {
+            const SensorData *sample = &samples[done + i];
+
+            uint32_t ts = sample->timestamp > UINT32_MAX ? UINT32_MAX : (uint32_t)sample->timestamp;
+            if (ts < span->min_ts)
+                span->min_ts = ts;
+            if (ts > span->max_ts)
+                span->max_ts = ts;
+
+            int32_t temp_centi = quantizeCenti(sample->temperature);
+            int32_t hum_centi = quantizeCenti(sample->humidity);
+            log_record_t *rec = &recs[i];
+            rec->seq = seq + i;
+            rec->timestamp = ts;
+            rec->temperature = (int16_t)(temp_centi > INT16_MAX ? INT16_MAX : temp_centi < INT16_MIN ? INT16_MIN : temp_centi);
+            rec->humidity = (uint16_t)(hum_centi > UINT16_MAX ? UINT16_MAX : hum_centi < 0 ? 0 : hum_centi);
+            rec->crc = record_crc(rec);
+        }
+
+        err = esp_partition_write(partition, record_offset(seq), recs, n * sizeof(recs[0]));
+
+        // Publica os registros só depois de gravados. Mesmo em caso de erro os
+        // slots são consumidos: eles podem ter sido parcialmente gravados.
+        atomic_store(&next_seq, seq + n);
+        done += n;
+    }
+
+    xSemaphoreGive(write_lock);
+
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Erro ao gravar registros: %s", esp_err_to_name(err));
+
+    return err;
+}
+
+esp_err_t log_store_read(uint32_t *seq, uint32_t end_seq, SensorData *out_array, uint32_t *out_seqs,
+                         size_t max_items, size_t *read_items)
+{
+    *read_items = 0;
+    if (!partition)
+        return ESP_ERR_INVALID_STATE;
+
+    // Registros sobrescritos pelo wrap-around desde a última leitura são pulados
+    uint32_t oldest = atomic_load(&oldest_seq);
+    uint32_t cur = *seq < oldest ? oldest : *seq;
+    uint32_t newest = atomic_load(&next_seq);
+    if (end_seq > newest)
+        end_seq = newest;
+
+    for (; cur < end_seq && *read_items < max_items; cur++)
+    {
+        // Registros corrompidos (ex.: queda de energia durante a gravação) são ignorados
+        log_record_t rec;
+        if (!read_record(cur, &rec))
+        {
+            ESP_LOGW(TAG, "Registro %lu inválido, ignorado", (unsigned long)cur);
+            continue;
+        }
+
+        if (out_seqs)
+            out_seqs[*read_items] = cur;
+
+        SensorData *data = &out_array[(*read_items)++];
+        data->timestamp = rec.timestamp;
+        data->temperature = dequantizeCenti(rec.temperature);
+        data->humidity = dequantizeCenti(rec.humidity);
+    }
+
+    *seq = cur;
+    return ESP_OK;
+}
+
+uint32_t log_store_seek_time(uint32_t seq, uint32_t end_seq, uint32_t from_time, uint32_t to_time)
+{
+    if (!partition)
+        return end_seq;
+
+    uint32_t oldest = atomic_load(&oldest_seq);
+    if (seq < oldest)
+        seq = oldest;
+
+    // Pula setores inteiros cuja faixa não cruza [from_time, to_time]
+    while (seq < end_seq)
+    {
+        log_span_t span = spans[(seq / LOG_STORE_RECORDS_PER_SECTOR) % sector_count];
+        if (span.max_ts >= from_time && span.min_ts <= to_time)
+            return seq;
+        seq = (seq / LOG_STORE_RECORDS_PER_SECTOR + 1) * LOG_STORE_RECORDS_PER_SECTOR;
+    }
+
+    return end_seq;
+}
+
+bool log_store_index_step(void)
+{
+    if (!partition || index_next >= sector_count)
+        return false;
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    // Só os registros visíveis ([oldest_seq, next_seq)) entram na faixa
+    uint32_t idx = index_next++;
+    log_span_t span = LOG_SPAN_EMPTY;
+    log_sector_hdr_t hdr;
+    if (read_header(idx, &hdr))
+    {
+        uint32_t seq = hdr.sector_seq * LOG_STORE_RECORDS_PER_SECTOR;
+        uint32_t end = seq + LOG_STORE_RECORDS_PER_SECTOR;
+        uint32_t oldest = atomic_load(&oldest_seq);
+        uint32_t newest = atomic_load(&next_seq);
+        if (seq < oldest)
+            seq = oldest;
+        if (end > newest)
+            end = newest;
+
+        while (seq < end)
+        {
+            log_record_t recs[LOG_STORE_WRITE_MAX_RECORDS];
+            uint32_t n = end - seq;
+            if (n > LOG_STORE_WRITE_MAX_RECORDS)
+                n = LOG_STORE_WRITE_MAX_RECORDS;
+            if (esp_partition_read(partition, record_offset(seq), recs, n * sizeof(recs[0])) != ESP_OK)
+            {
+                // Faixa desconhecida: o setor continua sendo consultado
+                span = LOG_SPAN_UNKNOWN;
+                break;
+            }
+
+            for (uint32_t i = 0; i < n; i++)
+            {
+                if (recs[i].seq != seq + i || recs[i].crc != record_crc(&recs[i]))
+                    continue;
+                if (recs[i].timestamp < span.min_ts)
+                    span.min_ts = recs[i].timestamp;
+                if (recs[i].timestamp > span.max_ts)
+                    span.max_ts = recs[i].timestamp;
+            }
+            seq += n;
+        }
+    }
+    spans[idx] = span;
+
+    xSemaphoreGive(write_lock);
+
+    if (index_next == sector_count)
+        ESP_LOGI(TAG, "Índice de tempo do log concluído");
+    return index_next < sector_count;
+}
+
+uint32_t log_store_oldest_seq(void)
+{
+    return atomic_load(&oldest_seq);
+}
+
+uint32_t log_store_next_seq(void)
+{
+    return atomic_load(&next_seq);
+}
+
+uint32_t log_store_count(void)
+{
+    if (!partition)
+        return 0;
+
+    uint32_t oldest = atomic_load(&oldest_seq);
+    return atomic_load(&next_seq) - oldest;
+}
+
+esp_err_t log_store_prepare(void)
+{
+    if (!partition)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    // Na fronteira, o setor corrente; perto do fim do setor, o próximo
+    esp_err_t err = ESP_OK;
+    uint32_t seq = atomic_load(&next_seq);
+    uint32_t sector = (seq + LOG_STORE_PREPARE_FREE) / LOG_STORE_RECORDS_PER_SECTOR;
+    if (seq % LOG_STORE_RECORDS_PER_SECTOR == 0)
+        sector = seq / LOG_STORE_RECORDS_PER_SECTOR;
+    if (sector * LOG_STORE_RECORDS_PER_SECTOR >= seq && ready_sector != sector)
+        err = open_sector(sector);
+
+    xSemaphoreGive(write_lock);
+
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Erro ao preparar setor: %s", esp_err_to_name(err));
+    return err;
+}
+
+esp_err_t log_store_clear(void)
+{
+    if (!partition)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    // O log recomeça no início do próximo setor; nada é apagado aqui
+    uint32_t newest = atomic_load(&next_seq);
+    uint32_t restart = (newest + LOG_STORE_RECORDS_PER_SECTOR - 1) / LOG_STORE_RECORDS_PER_SECTOR *
+                       LOG_STORE_RECORDS_PER_SECTOR;
+
+    base_seq = restart;
+    atomic_store(&oldest_seq, restart);
+    atomic_store(&next_seq, restart);
+
+    // O setor de restart precisa de um cabeçalho novo (com base_seq), mesmo
+    // que já tenha sido preparado
+    ready_sector = UINT32_MAX;
+
+    xSemaphoreGive(write_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sensor.pb.h"
+
+// ==========================
+// Log circular em partição de flash dedicada
+// ==========================
+//
+// A partição "datalog" é dividida em setores de 4 KB. Cada setor começa com
+// um cabeçalho e é seguido por registros de tamanho fixo, gravados apenas uma
+// vez (append-only). Cada registro recebe um número de sequência (seq)
+// monotônico; o setor que contém um seq é calculado diretamente:
+//
+//   setor lógico = seq / registros por setor
+//   setor físico = setor lógico % número de setores da partição
+//
+// Quando o setor corrente enche, o próximo setor é apagado e reutilizado,
+// descartando os registros mais antigos (wrap-around).
+//
+// Os registros guardam timestamp de 32 bits e valores quantizados em
+// centésimos (a mesma resolução do SensorDataBatch): 16 bytes por registro.
+//
+// Os timestamps são gravados como vieram da amostragem e podem voltar no tempo
+// (o relógio recomeça do horário de build a cada reboot). Para a busca por
+// tempo, cada setor tem em RAM a faixa [mínimo, máximo] dos seus timestamps:
+// atualizada a cada gravação e reconstruída em segundo plano após o boot
+// (log_store_index_step). Setores ainda não indexados nunca são pulados.
+
+#define LOG_STORE_PARTITION_LABEL "datalog"
+#define LOG_STORE_SECTOR_SIZE 4096
+
+// Inicializa o log (localiza a partição e recupera head/tail)
+esp_err_t log_store_init(void);
+
+// Anexa uma amostra ao final do log
+esp_err_t log_store_append(uint64_t timestamp, float temp, float hum);
+
+// Anexa várias amostras; registros contíguos de um mesmo setor vão em uma
+// única gravação na flash
+esp_err_t log_store_append_batch(const SensorData *samples, size_t count);
+
+// Lê até max_items registros com seq em [*seq, end_seq). Ao retornar, *seq
+// aponta para o próximo registro a ser lido (registros inválidos são pulados).
+// out_seqs (opcional) recebe o seq de cada registro lido.
+esp_err_t log_store_read(uint32_t *seq, uint32_t end_seq, SensorData *out_array, uint32_t *out_seqs,
+                         size_t max_items, size_t *read_items);
+
+// Primeiro seq >= seq (e < end_seq) cujo setor pode ter registros com timestamp
+// em [from_time, to_time]; end_seq se nenhum. Só consulta a faixa de cada
+// setor em RAM, sem ler a flash: os registros encontrados ainda precisam ser
+// filtrados um a um.
+uint32_t log_store_seek_time(uint32_t seq, uint32_t end_seq, uint32_t from_time, uint32_t to_time);
+
+// Indexa (faixa de timestamps) mais um setor gravado antes do boot. Retorna
+// true enquanto houver setores a indexar. Chamado pela task de gravação.
+bool log_store_index_step(void);
+
+// Faixa de seq válida: [oldest_seq, next_seq)
+uint32_t log_store_oldest_seq(void);
+uint32_t log_store_next_seq(void);
+uint32_t log_store_count(void);
+
+// Apaga todo o log em O(1), sem acessar a flash: os registros deixam de ser
+// visíveis na hora e o clear passa a valer também após um reboot quando o
+// próximo setor é preparado (log_store_prepare ou próximo append). Chamado pela
+// task de gravação: espera o write_lock, preso durante gravações na flash.
+esp_err_t log_store_clear(void);
+
+// Apaga e grava o cabeçalho do próximo setor se o log estiver em uma fronteira
+// de setor (após um clear) ou perto do fim do setor corrente. Chamado pela task
+// de gravação, para que o apagamento não ocorra no meio da descarga de um lote.
+esp_err_t log_store_prepare(void);
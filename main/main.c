@@ -9,14 +9,18 @@
 #include "ble_log.h"
 #include "nvs_controller.h"
 #include "temp_hum.h"
+#include "serial_bench.h"
 
 
 void app_main(void)
 {
+#if SERIAL_BENCH_ENABLE
+    serial_bench_run();
+#endif
 
     ESP_LOGI("MAIN", "Iniciando NVS...");
     nvs_controller_init();
-    temp_hum_init(&interval);
+    temp_hum_init(interval);
     ESP_LOGI("MAIN", "NVS rodando...");
 
     ESP_LOGI("MAIN", "Iniciando BLE...");
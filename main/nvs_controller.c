@@ -4,14 +4,73 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "ble_live.h"
+#include "log_store.h"
+#include "sample_ring.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
+#include <string.h>
 
 #define TAG "NVS_CTRL"
 #define NVS_NAMESPACE "storage"
-#define NVS_SENSOR_KEY_PREFIX "sd_" // Ex: sd_0, sd_1, ...
-#define NVS_SENSOR_COUNT_KEY "sd_count"
+#define NVS_LEGACY_KEY_PREFIX "sd_" // Formato antigo: sd_0, sd_1, ...
+#define NVS_LEGACY_COUNT_KEY "sd_count"
 #define NVS_CONFIG_KEY "sensor_cfg"
+#define NVS_WATERMARK_KEY_PREFIX "wm" // wm + endereço em hex (14 caracteres)
+
+#define LOG_WRITER_STACK_SIZE 3072
+#define LOG_WRITER_PRIORITY 2 // Abaixo do host NimBLE
+
+#define LOG_STAGE_MAGIC 0x47545353 // "SSTG"
+
+static TaskHandle_t log_writer_handle = NULL;
+
+// ==========================
+// Contexto de armazenamento
+// ==========================
+// Montado uma vez em nvs_controller_init(): o namespace fica aberto durante
+// toda a execução (a API da NVS é thread-safe) e as contagens ficam em RAM.
+// head/tail do log (log_store) são recuperados da flash no boot; as amostras
+// pendentes, do buffer RTC. Nenhuma chamada frequente consulta a NVS.
+typedef struct
+{
+    nvs_handle_t handle;      // Namespace NVS_NAMESPACE
+    bool open;
+    _Atomic uint32_t log_end; // Seq após a última amostra aceita (log + buffer), lido sem lock
+} nvs_ctx_t;
+
+static nvs_ctx_t ctx;
+
+// Buffer de gravação na RAM RTC: não é zerado no boot, então é validado por
+// magic, capacidade e CRC antes de ser aproveitado
+typedef struct
+{
+    uint32_t magic;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t crc; // CRC32 de samples[0..count)
+    SensorData samples[LOG_STAGE_SAMPLES];
+} log_stage_t;
+
+static RTC_NOINIT_ATTR log_stage_t log_stage;
+static SemaphoreHandle_t stage_lock = NULL;
+// Protege count/samples junto com ctx.log_end: a task de gravação altera os três
+// em seções críticas curtas e o host BLE copia um retrato consistente
+// (nvs_log_read_recent) sem esperar por stage_lock, que fica preso durante a
+// gravação na flash
+static portMUX_TYPE stage_mux = portMUX_INITIALIZER_UNLOCKED;
+static _Atomic bool flush_requested = false; // Pedido de descarga para a task de gravação
+static _Atomic bool clear_requested = false; // Clear pendente: leitores já veem o log vazio
 
 void load_sensor_config(void);
+static void migrate_legacy_sensor_data(void);
+static void log_writer_task(void *param);
+static void log_stage_init(void);
+static esp_err_t log_clear_now(void);
 
 // ==========================
 // Inicialização da NVS
@@ -29,7 +88,25 @@ esp_err_t nvs_controller_init(void)
 
     if (err == ESP_OK)
     {
+        err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &ctx.handle);
+        ctx.open = err == ESP_OK;
+        if (!ctx.open)
+        {
+            ESP_LOGE(TAG, "Falha ao abrir o namespace '%s': %s", NVS_NAMESPACE, esp_err_to_name(err));
+            return err;
+        }
+
         load_sensor_config(); // Só executa se a NVS foi inicializada com sucesso
+
+        if (log_store_init() == ESP_OK)
+        {
+            // Amostras antigas da NVS primeiro: as recuperadas do buffer RTC são
+            // mais novas e precisam de seqs maiores (ordem de seq = ordem de tempo)
+            migrate_legacy_sensor_data();
+            log_stage_init();
+            xTaskCreate(log_writer_task, "log_writer", LOG_WRITER_STACK_SIZE, NULL,
+                        LOG_WRITER_PRIORITY, &log_writer_handle);
+        }
     }
     else
     {
@@ -42,119 +119,447 @@ esp_err_t nvs_controller_init(void)
 // ==========================
 // Série Temporal - SensorData
 // ==========================
-esp_err_t nvs_save_sensor_data(float temp, float hum)
+// As amostras ficam no log circular da partição "datalog" (log_store.c).
+
+// Versões antigas gravavam cada amostra como uma chave NVS (sd_0, sd_1, ...).
+// Na primeira inicialização com o log em flash, esses dados são movidos para
+// o log e as chaves são apagadas.
+static void migrate_legacy_sensor_data(void)
 {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle));
+    nvs_handle_t handle = ctx.handle;
 
-    // Obter contador atual
     uint32_t count = 0;
-    nvs_get_u32(handle, NVS_SENSOR_COUNT_KEY, &count);
+    if (nvs_get_u32(handle, NVS_LEGACY_COUNT_KEY, &count) != ESP_OK)
+        return;
 
-    // Serializar SensorData
-    uint8_t buffer[SensorData_size];
-    size_t len = sizeof(buffer);
-    if (!serializeSensorData(buffer, &len, temp, hum))
+    ESP_LOGI(TAG, "Migrando %lu registros antigos da NVS para o log...", (unsigned long)count);
+
+    for (uint32_t i = 0; i < count; i++)
     {
-        ESP_LOGE(TAG, "Erro ao serializar SensorData.");
-        nvs_close(handle);
-        return ESP_FAIL;
+        char key[16];
+        snprintf(key, sizeof(key), NVS_LEGACY_KEY_PREFIX "%lu", (unsigned long)i);
+
+        uint8_t buffer[SensorData_size];
+        size_t len = sizeof(buffer);
+        SensorData data;
+
+        if (nvs_get_blob(handle, key, buffer, &len) == ESP_OK && deserializeSensorData(buffer, len, &data))
+            log_store_append(data.timestamp, data.temperature, data.humidity);
+
+        nvs_erase_key(handle, key);
     }
 
-    // Criar chave única (sd_0, sd_1, ...)
-    char key[16];
-    snprintf(key, sizeof(key), NVS_SENSOR_KEY_PREFIX "%lu", (unsigned long)count);
+    nvs_erase_key(handle, NVS_LEGACY_COUNT_KEY);
+    nvs_commit(handle);
+}
+
+// ==========================
+// Buffer de gravação (staging)
+// ==========================
+static uint32_t stage_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)log_stage.samples, log_stage.count * sizeof(log_stage.samples[0]));
+}
+
+static bool stage_valid(void)
+{
+    return log_stage.magic == LOG_STAGE_MAGIC && log_stage.capacity == LOG_STAGE_SAMPLES &&
+           log_stage.count <= LOG_STAGE_SAMPLES && log_stage.crc == stage_crc();
+}
 
-    esp_err_t err = nvs_set_blob(handle, key, buffer, len);
+// Chamado com stage_lock
+static esp_err_t stage_flush_locked(void)
+{
+    if (log_stage.count == 0)
+        return ESP_OK;
+
+    esp_err_t err = log_store_append_batch(log_stage.samples, log_stage.count);
     if (err == ESP_OK)
+        ESP_LOGI(TAG, "%lu amostras gravadas no log (até seq %lu)", (unsigned long)log_stage.count,
+                 (unsigned long)(log_store_next_seq() - 1));
+
+    // Mesmo com erro os slots do log foram consumidos: não regrava
+    portENTER_CRITICAL(&stage_mux);
+    log_stage.count = 0;
+    atomic_store(&ctx.log_end, log_store_next_seq());
+    portEXIT_CRITICAL(&stage_mux);
+    log_stage.crc = stage_crc();
+    return err;
+}
+
+static esp_err_t stage_add(const SensorData *sample)
+{
+    xSemaphoreTake(stage_lock, portMAX_DELAY);
+
+    portENTER_CRITICAL(&stage_mux);
+    log_stage.samples[log_stage.count++] = *sample;
+    atomic_fetch_add(&ctx.log_end, 1);
+    portEXIT_CRITICAL(&stage_mux);
+    log_stage.crc = stage_crc();
+
+    esp_err_t err = ESP_OK;
+    if (log_stage.count >= LOG_STAGE_SAMPLES)
+        err = stage_flush_locked();
+
+    xSemaphoreGive(stage_lock);
+    return err;
+}
+
+static void stage_shutdown_handler(void)
+{
+    nvs_log_flush();
+}
+
+// Recupera amostras deixadas no buffer por um reset/deep sleep anterior
+static void log_stage_init(void)
+{
+    stage_lock = xSemaphoreCreateMutex();
+    atomic_store(&ctx.log_end, log_store_next_seq());
+
+    if (stage_valid() && log_stage.count > 0)
+    {
+        ESP_LOGI(TAG, "Recuperando %lu amostras do buffer RTC", (unsigned long)log_stage.count);
+        stage_flush_locked();
+    }
+    else if (!stage_valid())
     {
-        nvs_set_u32(handle, NVS_SENSOR_COUNT_KEY, count + 1);
-        ESP_LOGI(TAG, "SensorData salvo com chave %s", key);
+        log_stage.magic = LOG_STAGE_MAGIC;
+        log_stage.capacity = LOG_STAGE_SAMPLES;
+        log_stage.count = 0;
+        log_stage.crc = stage_crc();
     }
 
-    nvs_commit(handle);
-    nvs_close(handle);
+    esp_register_shutdown_handler(stage_shutdown_handler);
+}
+
+// Pede à task de gravação que descarregue o buffer (não bloqueia: pode ser
+// chamada da task do host BLE)
+static void log_request_flush(void)
+{
+    if (!log_writer_handle || atomic_load(&ctx.log_end) == log_store_next_seq())
+        return;
+
+    atomic_store(&flush_requested, true);
+    xTaskNotifyGive(log_writer_handle);
+}
+
+esp_err_t nvs_log_flush(void)
+{
+    if (!stage_lock)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(stage_lock, portMAX_DELAY);
+    esp_err_t err = stage_flush_locked();
+    xSemaphoreGive(stage_lock);
     return err;
 }
 
-esp_err_t nvs_read_all_sensor_data(SensorData *out_array, size_t max_items, size_t *read_items)
+esp_err_t nvs_save_sensor_data(float temp, float hum)
 {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle));
+    if (!stage_lock)
+        return ESP_ERR_INVALID_STATE;
 
-    uint32_t count = 0;
-    nvs_get_u32(handle, NVS_SENSOR_COUNT_KEY, &count);
-    *read_items = 0;
+    SensorData sample = {
+        .timestamp = getUnixTimestamp(),
+        .temperature = temp,
+        .humidity = hum,
+    };
+    return stage_add(&sample);
+}
 
-    for (uint32_t i = 0; i < count && i < max_items; i++)
-    {
-        char key[16];
-        snprintf(key, sizeof(key), NVS_SENSOR_KEY_PREFIX "%lu", i);
+// Task de gravação: esvazia a fila de amostras no buffer de gravação, fora do
+// contexto de amostragem e do host BLE.
+static void log_writer_task(void *param)
+{
+    bool indexing = true;
 
-        uint8_t buffer[SensorData_size];
-        size_t len = sizeof(buffer);
-        esp_err_t err = nvs_get_blob(handle, key, buffer, &len);
+    for (;;)
+    {
+        // Enquanto o índice de tempo do boot não termina, indexa um setor por tick
+        ulTaskNotifyTake(pdTRUE, indexing ? 1 : portMAX_DELAY);
 
-        if (err == ESP_OK)
+        // Antes de esvaziar a fila: amostras ainda não aceitas sobrevivem ao clear
+        if (atomic_load(&clear_requested))
         {
-            SensorData data;
-            if (deserializeSensorData(buffer, len, &data))
-            {
-                out_array[i] = data;
-                (*read_items)++;
-            }
-            else
-            {
-                ESP_LOGW(TAG, "Falha ao desserializar item %s", key);
-            }
+            log_clear_now();
+            atomic_store(&clear_requested, false);
         }
+
+        SensorData sample;
+        while (sample_ring_pop(&sample))
+            stage_add(&sample);
+
+        if (atomic_exchange(&flush_requested, false))
+            nvs_log_flush();
+
+        // Apagamento do próximo setor (após clear ou setor cheio) fica nesta task
+        log_store_prepare();
+
+        if (indexing)
+            indexing = log_store_index_step();
     }
+}
+
+esp_err_t nvs_enqueue_sensor_data(const SensorData *sample)
+{
+    if (!log_writer_handle)
+        return ESP_ERR_INVALID_STATE;
 
-    nvs_close(handle);
+    if (!sample_ring_push(sample))
+    {
+        ESP_LOGW(TAG, "Fila de gravação cheia, amostra descartada (%lu no total)",
+                 (unsigned long)sample_ring_dropped());
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskNotifyGive(log_writer_handle);
     return ESP_OK;
 }
 
+esp_err_t nvs_read_all_sensor_data(SensorData *out_array, size_t max_items, size_t *read_items)
+{
+    nvs_log_flush();
+
+    uint32_t seq = log_store_oldest_seq();
+    return log_store_read(&seq, log_store_next_seq(), out_array, NULL, max_items, read_items);
+}
+
 esp_err_t nvs_get_sensor_data_count(uint32_t *count)
 {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle));
-    nvs_get_u32(handle, NVS_SENSOR_COUNT_KEY, count);
-    nvs_close(handle);
+    // Só contadores em RAM: amostras no log mais as pendentes no buffer
+    if (atomic_load(&clear_requested))
+        *count = 0;
+    else
+        *count = atomic_load(&ctx.log_end) - log_store_oldest_seq();
     return ESP_OK;
 }
 
-esp_err_t nvs_clear_all_sensor_data(void)
+uint32_t nvs_log_end_seq(void)
 {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle));
+    return atomic_load(&ctx.log_end);
+}
 
-    uint32_t count = 0;
-    esp_err_t err = nvs_get_u32(handle, NVS_SENSOR_COUNT_KEY, &count);
+esp_err_t nvs_log_read_recent(SensorData *out_array, uint32_t *out_seqs, size_t max_items, size_t *read_items)
+{
+    *read_items = 0;
+    if (!stage_lock)
+        return ESP_ERR_INVALID_STATE;
+    if (atomic_load(&clear_requested))
+        return ESP_OK;
+
+    // Retrato do buffer e do fim do log: as amostras pendentes vão para o fim
+    // de out_array e ocupam [log_end - count, log_end)
+    portENTER_CRITICAL(&stage_mux);
+    uint32_t staged = log_stage.count;
+    uint32_t end = atomic_load(&ctx.log_end);
+    size_t from_stage = staged < max_items ? staged : max_items;
+    memcpy(&out_array[max_items - from_stage], &log_stage.samples[staged - from_stage],
+           from_stage * sizeof(SensorData));
+    portEXIT_CRITICAL(&stage_mux);
+
+    // O restante vem da flash, logo antes do primeiro seq do buffer. Durante a
+    // descarga esses registros já estão na flash, mas o retrato ainda os conta
+    // no buffer, então a janela não repete nem pula amostras.
+    uint32_t stage_base = end - staged;
+    uint32_t oldest = log_store_oldest_seq();
+    uint32_t available = (int32_t)(stage_base - oldest) > 0 ? stage_base - oldest : 0; // Clear em curso
+    size_t from_log = max_items - from_stage;
+    if (available < from_log)
+        from_log = available;
+
+    size_t count = 0;
+    uint32_t seq = stage_base - from_log;
+    esp_err_t err = log_store_read(&seq, stage_base, out_array, out_seqs, from_log, &count);
     if (err != ESP_OK)
         count = 0;
 
-    for (uint32_t i = 0; i < count; i++)
+    memmove(&out_array[count], &out_array[max_items - from_stage], from_stage * sizeof(SensorData));
+    if (out_seqs)
     {
-        char key[16];
-        snprintf(key, sizeof(key), NVS_SENSOR_KEY_PREFIX "%lu", i);
-        nvs_erase_key(handle, key);
+        for (size_t i = 0; i < from_stage; i++)
+            out_seqs[count + i] = end - from_stage + i;
     }
 
-    nvs_erase_key(handle, NVS_SENSOR_COUNT_KEY);
-    nvs_commit(handle);
-    nvs_close(handle);
+    *read_items = count + from_stage;
+    return ESP_OK;
+}
+
+// ==========================
+// Cursor de leitura do log
+// ==========================
+esp_err_t nvs_log_cursor_open(nvs_log_cursor_t *cursor)
+{
+    // Download: o fim inclui as amostras do buffer, que a task de gravação
+    // descarrega em seguida; a leitura delas espera a gravação
+    cursor->next_seq = log_store_oldest_seq();
+    cursor->end_seq = atomic_load(&ctx.log_end);
+    if (atomic_load(&clear_requested))
+        cursor->next_seq = cursor->end_seq;
+    log_request_flush();
+    cursor->from_time = 0;
+    cursor->to_time = UINT32_MAX;
+    return ESP_OK;
+}
+
+esp_err_t nvs_log_cursor_open_range(nvs_log_cursor_t *cursor, uint32_t from_seq, uint64_t from_time, uint64_t to_time)
+{
+    nvs_log_cursor_open(cursor);
+
+    // seq -> posição é direto no log; o tempo é filtrado na leitura
+    if (from_seq > cursor->next_seq)
+        cursor->next_seq = from_seq;
+
+    // Timestamps do log têm 32 bits
+    if (from_time > UINT32_MAX)
+        cursor->next_seq = cursor->end_seq;
+    cursor->from_time = (uint32_t)from_time;
+    if (to_time > 0 && to_time < UINT32_MAX)
+        cursor->to_time = (uint32_t)to_time;
+
+    if (cursor->next_seq > cursor->end_seq)
+        cursor->next_seq = cursor->end_seq;
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_log_cursor_next(nvs_log_cursor_t *cursor, SensorData *out_array, uint32_t *out_seqs,
+                              size_t max_items, size_t *read_items)
+{
+    *read_items = 0;
+
+    // Descarga que falhou (slots não consumidos): o fim recua junto com o log
+    uint32_t log_end = atomic_load(&ctx.log_end);
+    if (cursor->end_seq > log_end && log_end >= cursor->next_seq)
+        cursor->end_seq = log_end;
+
+    // Pula os setores sem registros na faixa de tempo e filtra o restante,
+    // até ter algum registro ou chegar ao fim
+    while (*read_items == 0 && cursor->next_seq < cursor->end_seq)
+    {
+        // Só o que já está na flash (a faixa de tempo do setor corrente ainda
+        // não inclui as amostras do buffer)
+        uint32_t written = log_store_next_seq();
+        if (written > cursor->end_seq)
+            written = cursor->end_seq;
+
+        cursor->next_seq = log_store_seek_time(cursor->next_seq, written, cursor->from_time, cursor->to_time);
+        if (cursor->next_seq >= written)
+        {
+            if (written < cursor->end_seq)
+                return ESP_ERR_NOT_FINISHED; // Amostras ainda no buffer de gravação
+            break;
+        }
+
+        size_t read = 0;
+        esp_err_t err = log_store_read(&cursor->next_seq, written, out_array, out_seqs, max_items, &read);
+        if (err != ESP_OK)
+            return err;
+
+        for (size_t i = 0; i < read; i++)
+        {
+            if (out_array[i].timestamp < cursor->from_time || out_array[i].timestamp > cursor->to_time)
+                continue;
+            if (out_seqs)
+                out_seqs[*read_items] = out_seqs[i];
+            out_array[(*read_items)++] = out_array[i];
+        }
 
-    ESP_LOGI(TAG, "Todos os dados SensorData foram apagados.");
+        // Nada legível até o fim do log (ex.: apagado durante a leitura)
+        if (read == 0 && cursor->next_seq < written)
+            break;
+    }
+
+    return ESP_OK;
+}
+
+bool nvs_log_cursor_done(const nvs_log_cursor_t *cursor)
+{
+    return cursor->next_seq >= cursor->end_seq;
+}
+
+void nvs_log_cursor_close(nvs_log_cursor_t *cursor)
+{
+    cursor->next_seq = cursor->end_seq;
+}
+
+// Executa o clear. Chamado pela task de gravação (ou direto, se ela não existe):
+// stage_lock e o write_lock do log ficam presos durante gravações na flash
+static esp_err_t log_clear_now(void)
+{
+    if (stage_lock)
+    {
+        xSemaphoreTake(stage_lock, portMAX_DELAY);
+        portENTER_CRITICAL(&stage_mux);
+        log_stage.count = 0;
+        portEXIT_CRITICAL(&stage_mux);
+        log_stage.crc = stage_crc();
+        xSemaphoreGive(stage_lock);
+    }
+
+    // O(1): só ajusta o início do log; o setor novo é preparado pela task de gravação
+    esp_err_t err = log_store_clear();
+    portENTER_CRITICAL(&stage_mux);
+    atomic_store(&ctx.log_end, log_store_next_seq());
+    portEXIT_CRITICAL(&stage_mux);
+    if (err == ESP_OK)
+        ESP_LOGI(TAG, "Todos os dados SensorData foram apagados.");
+
+    return err;
+}
+
+esp_err_t nvs_clear_all_sensor_data(void)
+{
+    if (!log_writer_handle)
+        return log_clear_now();
+
+    // Não bloqueia: o clear é feito pela task de gravação
+    atomic_store(&clear_requested, true);
+    xTaskNotifyGive(log_writer_handle);
     return ESP_OK;
 }
 
+// ==========================
+// Marca d'água de sincronização
+// ==========================
+static void watermark_key(char key[16], const uint8_t addr[6])
+{
+    snprintf(key, 16, NVS_WATERMARK_KEY_PREFIX "%02x%02x%02x%02x%02x%02x",
+             addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+}
+
+esp_err_t nvs_load_sync_watermark(const uint8_t addr[6], uint32_t *seq)
+{
+    if (!ctx.open)
+        return ESP_ERR_INVALID_STATE;
+
+    char key[16];
+    watermark_key(key, addr);
+    return nvs_get_u32(ctx.handle, key, seq);
+}
+
+esp_err_t nvs_save_sync_watermark(const uint8_t addr[6], uint32_t seq)
+{
+    if (!ctx.open)
+        return ESP_ERR_INVALID_STATE;
+
+    char key[16];
+    watermark_key(key, addr);
+    esp_err_t err = nvs_set_u32(ctx.handle, key, seq);
+    if (err == ESP_OK)
+        err = nvs_commit(ctx.handle);
+
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Erro ao salvar marca de sincronização: %s", esp_err_to_name(err));
+    return err;
+}
+
 // ==========================
 // SensorConfig
 // ==========================
 esp_err_t nvs_save_sensor_config(SensorConfig *cfg)
 {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle));
+    if (!ctx.open)
+        return ESP_ERR_INVALID_STATE;
 
     uint8_t buffer[SensorConfig_size];
     size_t len = sizeof(buffer);
@@ -162,15 +567,13 @@ esp_err_t nvs_save_sensor_config(SensorConfig *cfg)
     if (!serializeSensorConfig(buffer, &len, cfg))
     {
         ESP_LOGE(TAG, "Erro ao serializar SensorConfig.");
-        nvs_close(handle);
         return ESP_FAIL;
     }
 
-    esp_err_t err = nvs_set_blob(handle, NVS_CONFIG_KEY, buffer, len);
+    esp_err_t err = nvs_set_blob(ctx.handle, NVS_CONFIG_KEY, buffer, len);
     if (err == ESP_OK)
-        nvs_commit(handle);
+        nvs_commit(ctx.handle);
 
-    nvs_close(handle);
     return err;
 }
 
@@ -186,22 +589,19 @@ SensorConfig nvs_read_sensor_config(void)
         // adicione outros campos default, se houver
     };
 
-    nvs_handle_t handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
-    if (err != ESP_OK)
+    if (!ctx.open)
     {
-        ESP_LOGW(TAG, "Namespace ainda não existe: %s", esp_err_to_name(err));
+        ESP_LOGW(TAG, "NVS não inicializada, usando configuração padrão");
         return cfg;
     }
 
     uint8_t buffer[SensorConfig_size];
     size_t len = sizeof(buffer);
 
-    err = nvs_get_blob(handle, NVS_CONFIG_KEY, buffer, &len);
+    esp_err_t err = nvs_get_blob(ctx.handle, NVS_CONFIG_KEY, buffer, &len);
     if (err != ESP_OK)
     {
         ESP_LOGW(TAG, "Nenhuma configuração encontrada.");
-        nvs_close(handle);
         return cfg;
     }
 
@@ -210,7 +610,6 @@ SensorConfig nvs_read_sensor_config(void)
         ESP_LOGE(TAG, "Erro ao desserializar SensorConfig.");
     }
 
-    nvs_close(handle);
     return cfg;
 }
 
@@ -219,14 +618,17 @@ void load_sensor_config(void)
 
     SensorConfig data = nvs_read_sensor_config();
 
+    repeatability = data.repeatability;
+    beacon_mode = data.beacon;
+
     if (data.interval == 0)
     {
         interval = 60;
-        ESP_LOGI(TAG, "Configuração carregada: Interval: %llu", interval);
+        ESP_LOGI(TAG, "Configuração carregada: Interval: %llu", (unsigned long long)interval);
     }
     else
     {
         interval = data.interval;
-        ESP_LOGI(TAG, "Configuração carregada: Interval: %llu", interval);
+        ESP_LOGI(TAG, "Configuração carregada: Interval: %llu", (unsigned long long)interval);
     }
 }
@@ -6,15 +6,79 @@
 #include "esp_err.h"
 #include "sensor.pb.h"
 
+// ==========================
+// Buffer de gravação do log (staging)
+// ==========================
+// As amostras ficam em um buffer na RAM RTC (RTC_NOINIT) e vão para a flash
+// em uma única gravação a cada LOG_STAGE_SAMPLES amostras, em vez de uma por
+// amostra. O buffer também é descarregado pela task de gravação ao abrir um
+// cursor de leitura (download), em nvs_log_flush() e antes de um esp_restart().
+//
+// Janela de perda: até LOG_STAGE_SAMPLES - 1 amostras (LOG_STAGE_SAMPLES x
+// intervalo de amostragem) existem só na RAM RTC. Elas sobrevivem a reset por
+// software, watchdog, panic e deep sleep (são gravadas no boot seguinte), mas
+// se perdem em queda de alimentação ou brownout. Com 1, cada amostra é
+// gravada imediatamente.
+#ifndef LOG_STAGE_SAMPLES
+#define LOG_STAGE_SAMPLES 16
+#endif
+
 // Inicializa a NVS
 esp_err_t nvs_controller_init(void);
 
+// Grava na flash as amostras pendentes no buffer (ex.: antes de dormir).
+// Bloqueia durante a gravação: não chamar da task do host BLE.
+esp_err_t nvs_log_flush(void);
+
 // Série temporal SensorData
 esp_err_t nvs_save_sensor_data(float temp, float hum);
+// Enfileira a amostra para a task de gravação (não bloqueia; pode ser chamada durante downloads)
+esp_err_t nvs_enqueue_sensor_data(const SensorData *sample);
 esp_err_t nvs_read_all_sensor_data(SensorData *out_array, size_t max_items, size_t *read_items);
 esp_err_t nvs_get_sensor_data_count(uint32_t *count);
+// Não bloqueia: o log passa a ser visto vazio na hora (contagem, cursores e
+// nvs_log_read_recent) e é apagado em seguida pela task de gravação
 esp_err_t nvs_clear_all_sensor_data(void);
 
+// Seq após a última amostra aceita (log + buffer de gravação): o mesmo fim que
+// GETLENGTH e os downloads enxergam. Não bloqueia.
+uint32_t nvs_log_end_seq(void);
+// Até max_items amostras mais recentes (log + buffer de gravação), em ordem,
+// terminando em nvs_log_end_seq(). Não bloqueia: pode ser chamada da task do
+// host BLE. out_seqs (opcional) recebe o seq de cada amostra.
+esp_err_t nvs_log_read_recent(SensorData *out_array, uint32_t *out_seqs, size_t max_items, size_t *read_items);
+
+// Cursor para leitura incremental do log (sem carregar o histórico em RAM).
+// O fim é fixado na abertura e inclui as amostras ainda no buffer de gravação:
+// a abertura só pede a descarga à task de gravação, sem bloquear. Enquanto o
+// próximo registro não chega à flash, nvs_log_cursor_next() retorna
+// ESP_ERR_NOT_FINISHED (sem registros): basta tentar de novo em seguida.
+// Amostras aceitas depois da abertura não entram na leitura.
+typedef struct
+{
+    uint32_t next_seq;  // Próximo registro a ler
+    uint32_t end_seq;   // Fim da leitura (exclusivo)
+    uint32_t from_time; // Filtro de timestamp [from_time, to_time]
+    uint32_t to_time;
+} nvs_log_cursor_t;
+
+esp_err_t nvs_log_cursor_open(nvs_log_cursor_t *cursor);
+// Cursor só sobre os registros com seq >= from_seq e timestamp em
+// [from_time, to_time] (to_time = 0: sem limite). Como o relógio pode voltar
+// no tempo após um reboot, o filtro de tempo é aplicado registro a registro;
+// setores inteiros fora da faixa são pulados sem leitura (log_store_seek_time).
+// Com filtro de tempo, end_seq - next_seq é só um limite superior.
+esp_err_t nvs_log_cursor_open_range(nvs_log_cursor_t *cursor, uint32_t from_seq, uint64_t from_time, uint64_t to_time);
+// out_seqs (opcional) recebe o seq de cada registro lido
+esp_err_t nvs_log_cursor_next(nvs_log_cursor_t *cursor, SensorData *out_array, uint32_t *out_seqs,
+                              size_t max_items, size_t *read_items);
+bool nvs_log_cursor_done(const nvs_log_cursor_t *cursor);
+void nvs_log_cursor_close(nvs_log_cursor_t *cursor);
+
+// Marca d'água de sincronização por cliente (endereço de identidade BLE)
+esp_err_t nvs_load_sync_watermark(const uint8_t addr[6], uint32_t *seq);
+esp_err_t nvs_save_sync_watermark(const uint8_t addr[6], uint32_t seq);
+
 // Configuração SensorConfig
 esp_err_t nvs_save_sensor_config(SensorConfig *cfg);
 esp_err_t nvs_update_sensor_config(SensorConfig *cfg);
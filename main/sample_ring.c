@@ -0,0 +1,43 @@
+#include "sample_ring.h"
+#include <stdatomic.h>
+
+_Static_assert((SAMPLE_RING_SIZE & (SAMPLE_RING_SIZE - 1)) == 0, "SAMPLE_RING_SIZE deve ser potência de 2");
+
+static SensorData ring[SAMPLE_RING_SIZE];
+static _Atomic uint32_t head = 0; // Escrito apenas pelo produtor
+static _Atomic uint32_t tail = 0; // Escrito apenas pelo consumidor
+static _Atomic uint32_t dropped = 0;
+
+bool sample_ring_push(const SensorData *sample)
+{
+    uint32_t h = atomic_load_explicit(&head, memory_order_relaxed);
+    uint32_t t = atomic_load_explicit(&tail, memory_order_acquire);
+
+    if (h - t >= SAMPLE_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    ring[h & (SAMPLE_RING_SIZE - 1)] = *sample;
+    atomic_store_explicit(&head, h + 1, memory_order_release);
+    return true;
+}
+
+bool sample_ring_pop(SensorData *sample)
+{
+    uint32_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+    uint32_t h = atomic_load_explicit(&head, memory_order_acquire);
+
+    if (t == h)
+        return false;
+
+    *sample = ring[t & (SAMPLE_RING_SIZE - 1)];
+    atomic_store_explicit(&tail, t + 1, memory_order_release);
+    return true;
+}
+
+uint32_t sample_ring_dropped(void)
+{
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor.pb.h"
+
+// ==========================
+// Fila lock-free de amostras (um produtor / um consumidor)
+// ==========================
+// O produtor é o contexto de amostragem e o consumidor é a task que grava o
+// log em flash. Nenhum dos lados bloqueia: se a fila estiver cheia a amostra
+// é descartada e contabilizada.
+
+#define SAMPLE_RING_SIZE 32 // Potência de 2
+
+bool sample_ring_push(const SensorData *sample);
+bool sample_ring_pop(SensorData *sample);
+uint32_t sample_ring_dropped(void);
@@ -9,6 +9,9 @@
 PB_BIND(SensorData, SensorData, AUTO)
 
 
+PB_BIND(SensorDataBatch, SensorDataBatch, 2)
+
+
 PB_BIND(SensorConfig, SensorConfig, AUTO)
 
 
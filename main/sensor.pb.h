@@ -16,12 +16,21 @@ typedef enum _SensorConfig_Log_mode {
     SensorConfig_Log_mode_DEFINED = 3
 } SensorConfig_Log_mode;
 
+typedef enum _SensorConfig_Repeatability {
+    SensorConfig_Repeatability_HIGH = 0,
+    SensorConfig_Repeatability_MEDIUM = 1,
+    SensorConfig_Repeatability_LOW = 2
+} SensorConfig_Repeatability;
+
 typedef enum _LogControl_Command {
     LogControl_Command_START = 0,
     LogControl_Command_STOP = 1,
     LogControl_Command_CLEAR = 2,
     LogControl_Command_NEXT = 3,
-    LogControl_Command_GETLENGTH = 4
+    LogControl_Command_GETLENGTH = 4,
+    LogControl_Command_CREDIT = 5, /* length = créditos (notificações) concedidos ao streaming */
+    LogControl_Command_ACK = 6, /* from_seq = próximo seq que o cliente ainda não tem */
+    LogControl_Command_RESUME = 7 /* START a partir da marca d'água do cliente */
 } LogControl_Command;
 
 /* Struct definitions */
@@ -31,16 +40,41 @@ typedef struct _SensorData {
     float humidity;
 } SensorData;
 
+/* Lote de registros do log. Os valores são quantizados (centésimos de °C e de
+ %UR) e os timestamps são dados pelo desvio em relação à grade
+ base_timestamp + i * interval, então amostras regulares ocupam ~5 bytes.
+   timestamp[i]   = base_timestamp + i * interval + delta_timestamps[i]
+   temperature[i] = temperatures[i] / 100.0
+   humidity[i]    = humidities[i] / 100.0
+   seq[i]         = first_seq + i */
+typedef struct _SensorDataBatch {
+    uint64_t base_timestamp;
+    uint32_t interval;
+    pb_size_t delta_timestamps_count;
+    int32_t delta_timestamps[64];
+    pb_size_t temperatures_count;
+    int32_t temperatures[64];
+    pb_size_t humidities_count;
+    int32_t humidities[64];
+    uint32_t first_seq; /* seq do primeiro registro (retomada de sincronização) */
+} SensorDataBatch;
+
 typedef struct _SensorConfig {
     uint64_t interval;
     SensorConfig_Log_mode log_mode;
     uint64_t date_time_init;
     uint64_t date_time_stop;
+    SensorConfig_Repeatability repeatability;
+    bool beacon; /* Leituras no advertising (service data 0x1809) */
 } SensorConfig;
 
 typedef struct _LogControl {
     LogControl_Command command;
     uint32_t length;
+    /* Faixa do START (campos ausentes = log inteiro) */
+    uint32_t from_seq; /* Primeiro seq a enviar */
+    uint64_t from_time; /* Só registros com timestamp >= from_time */
+    uint64_t to_time; /* Só registros com timestamp <= to_time (0 = sem limite) */
 } LogControl;
 
 
@@ -53,34 +87,52 @@ extern "C" {
 #define _SensorConfig_Log_mode_MAX SensorConfig_Log_mode_DEFINED
 #define _SensorConfig_Log_mode_ARRAYSIZE ((SensorConfig_Log_mode)(SensorConfig_Log_mode_DEFINED+1))
 
+#define _SensorConfig_Repeatability_MIN SensorConfig_Repeatability_HIGH
+#define _SensorConfig_Repeatability_MAX SensorConfig_Repeatability_LOW
+#define _SensorConfig_Repeatability_ARRAYSIZE ((SensorConfig_Repeatability)(SensorConfig_Repeatability_LOW+1))
+
 #define _LogControl_Command_MIN LogControl_Command_START
-#define _LogControl_Command_MAX LogControl_Command_GETLENGTH
-#define _LogControl_Command_ARRAYSIZE ((LogControl_Command)(LogControl_Command_GETLENGTH+1))
+#define _LogControl_Command_MAX LogControl_Command_RESUME
+#define _LogControl_Command_ARRAYSIZE ((LogControl_Command)(LogControl_Command_RESUME+1))
 
 
 #define SensorConfig_log_mode_ENUMTYPE SensorConfig_Log_mode
+#define SensorConfig_repeatability_ENUMTYPE SensorConfig_Repeatability
 
 #define LogControl_command_ENUMTYPE LogControl_Command
 
 
 /* Initializer values for message structs */
 #define SensorData_init_default                  {0, 0, 0}
-#define SensorConfig_init_default                {0, _SensorConfig_Log_mode_MIN, 0, 0}
-#define LogControl_init_default                  {_LogControl_Command_MIN, 0}
+#define SensorDataBatch_init_default             {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0}
+#define SensorConfig_init_default                {0, _SensorConfig_Log_mode_MIN, 0, 0, _SensorConfig_Repeatability_MIN, 0}
+#define LogControl_init_default                  {_LogControl_Command_MIN, 0, 0, 0, 0}
 #define SensorData_init_zero                     {0, 0, 0}
-#define SensorConfig_init_zero                   {0, _SensorConfig_Log_mode_MIN, 0, 0}
-#define LogControl_init_zero                     {_LogControl_Command_MIN, 0}
+#define SensorDataBatch_init_zero                {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0}
+#define SensorConfig_init_zero                   {0, _SensorConfig_Log_mode_MIN, 0, 0, _SensorConfig_Repeatability_MIN, 0}
+#define LogControl_init_zero                     {_LogControl_Command_MIN, 0, 0, 0, 0}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define SensorData_timestamp_tag                 1
 #define SensorData_temperature_tag               2
 #define SensorData_humidity_tag                  3
+#define SensorDataBatch_base_timestamp_tag       1
+#define SensorDataBatch_interval_tag             2
+#define SensorDataBatch_delta_timestamps_tag     3
+#define SensorDataBatch_temperatures_tag         4
+#define SensorDataBatch_humidities_tag           5
+#define SensorDataBatch_first_seq_tag            6
 #define SensorConfig_interval_tag                1
 #define SensorConfig_log_mode_tag                2
 #define SensorConfig_date_time_init_tag          3
 #define SensorConfig_date_time_stop_tag          4
+#define SensorConfig_repeatability_tag           5
+#define SensorConfig_beacon_tag                  6
 #define LogControl_command_tag                   1
 #define LogControl_length_tag                    2
+#define LogControl_from_seq_tag                  3
+#define LogControl_from_time_tag                 4
+#define LogControl_to_time_tag                   5
 
 /* Struct field encoding specification for nanopb */
 #define SensorData_FIELDLIST(X, a) \
@@ -90,33 +142,51 @@ X(a, STATIC,   SINGULAR, FLOAT,    humidity,          3)
 #define SensorData_CALLBACK NULL
 #define SensorData_DEFAULT NULL
 
+#define SensorDataBatch_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT64,   base_timestamp,    1) \
+X(a, STATIC,   SINGULAR, UINT32,   interval,          2) \
+X(a, STATIC,   REPEATED, SINT32,   delta_timestamps,  3) \
+X(a, STATIC,   REPEATED, SINT32,   temperatures,      4) \
+X(a, STATIC,   REPEATED, SINT32,   humidities,        5) \
+X(a, STATIC,   SINGULAR, UINT32,   first_seq,         6)
+#define SensorDataBatch_CALLBACK NULL
+#define SensorDataBatch_DEFAULT NULL
+
 #define SensorConfig_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, UINT64,   interval,          1) \
 X(a, STATIC,   SINGULAR, UENUM,    log_mode,          2) \
 X(a, STATIC,   SINGULAR, UINT64,   date_time_init,    3) \
-X(a, STATIC,   SINGULAR, UINT64,   date_time_stop,    4)
+X(a, STATIC,   SINGULAR, UINT64,   date_time_stop,    4) \
+X(a, STATIC,   SINGULAR, UENUM,    repeatability,     5) \
+X(a, STATIC,   SINGULAR, BOOL,     beacon,            6)
 #define SensorConfig_CALLBACK NULL
 #define SensorConfig_DEFAULT NULL
 
 #define LogControl_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, UENUM,    command,           1) \
-X(a, STATIC,   SINGULAR, UINT32,   length,            2)
+X(a, STATIC,   SINGULAR, UINT32,   length,            2) \
+X(a, STATIC,   SINGULAR, UINT32,   from_seq,          3) \
+X(a, STATIC,   SINGULAR, UINT64,   from_time,         4) \
+X(a, STATIC,   SINGULAR, UINT64,   to_time,           5)
 #define LogControl_CALLBACK NULL
 #define LogControl_DEFAULT NULL
 
 extern const pb_msgdesc_t SensorData_msg;
+extern const pb_msgdesc_t SensorDataBatch_msg;
 extern const pb_msgdesc_t SensorConfig_msg;
 extern const pb_msgdesc_t LogControl_msg;
 
 /* Defines for backwards compatibility with code written before nanopb-0.4.0 */
 #define SensorData_fields &SensorData_msg
+#define SensorDataBatch_fields &SensorDataBatch_msg
 #define SensorConfig_fields &SensorConfig_msg
 #define LogControl_fields &LogControl_msg
 
 /* Maximum encoded size of messages (where known) */
-#define LogControl_size                          8
-#define SENSOR_PB_H_MAX_SIZE                     SensorConfig_size
-#define SensorConfig_size                        35
+#define LogControl_size                          36
+#define SENSOR_PB_H_MAX_SIZE                     SensorDataBatch_size
+#define SensorConfig_size                        39
+#define SensorDataBatch_size                     992
 #define SensorData_size                          21
 
 #ifdef __cplusplus
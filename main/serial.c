@@ -5,9 +5,306 @@
 #include "pb_encode.h"
 #include "pb_decode.h"
 #include "build_time.h"
+#include <string.h>
+#include <math.h>
 
 static const char *TAG = "SERIAL";
 
+// ==============================
+// Relógio
+// ==============================
+uint64_t getUnixTimestamp(void) {
+    return esp_timer_get_time() / 1000000ULL + BUILD_UNIX_TIMESTAMP; // Em segundos
+}
+
+uint64_t getUnixTimeUs(void) {
+    return esp_timer_get_time() + BUILD_UNIX_TIMESTAMP * 1000000ULL;
+}
+
+// ==============================
+// Codec especializado
+// ==============================
+// SensorData e LogControl têm layout fixo; estas funções geram exatamente os
+// mesmos bytes que o pb_encode (proto3: campos com valor zero são omitidos,
+// na ordem dos números de campo) sem percorrer descritores nem streams.
+
+#define WIRE_VARINT  0
+#define WIRE_64BIT   1
+#define WIRE_LEN     2
+#define WIRE_32BIT   5
+#define FIELD_TAG(field, wire) ((uint8_t)(((field) << 3) | (wire)))
+
+static inline size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline size_t put_fixed32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return 4;
+}
+
+static inline size_t varint_size(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static inline uint32_t zigzag32(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline uint32_t float_bits(float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static inline bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *out)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (*p >= end)
+            return false;
+        uint8_t b = *(*p)++;
+        if (shift == 63 && (b & 0xFE))
+            return false; // Não cabe em 64 bits
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Chave do campo: aceita e rejeita exatamente o que o pb_decode_varint32 aceita
+static inline bool get_key(const uint8_t **p, const uint8_t *end, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        if (*p >= end)
+            return false;
+        uint8_t b = *(*p)++;
+        if (shift >= 32) {
+            uint8_t sign_extension = shift < 63 ? 0xFF : 0x01;
+            if (shift >= 64 || ((b & 0x7F) != 0 && ((v >> 31) == 0 || b != sign_extension)))
+                return false;
+        } else if (shift == 28) {
+            if ((b & 0x70) != 0 && (b & 0x78) != 0x78)
+                return false;
+            v |= (uint32_t)(b & 0x0F) << shift;
+        } else {
+            v |= (uint32_t)(b & 0x7F) << shift;
+        }
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+}
+
+static inline bool get_fixed32(const uint8_t **p, const uint8_t *end, uint32_t *out)
+{
+    if (end - *p < 4)
+        return false;
+    const uint8_t *b = *p;
+    *out = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    *p += 4;
+    return true;
+}
+
+// Pula um campo desconhecido, como o pb_decode
+static bool skip_field(const uint8_t **p, const uint8_t *end, uint32_t wire)
+{
+    uint64_t v;
+    switch (wire) {
+    case WIRE_VARINT:
+        // Como o pb_skip_varint: só procura o último byte, sem limite de tamanho
+        do {
+            if (*p >= end)
+                return false;
+        } while (*(*p)++ & 0x80);
+        return true;
+    case WIRE_64BIT:
+        if (end - *p < 8)
+            return false;
+        *p += 8;
+        return true;
+    case WIRE_LEN:
+        if (!get_varint(p, end, &v) || v > (uint64_t)(end - *p))
+            return false;
+        *p += v;
+        return true;
+    case WIRE_32BIT:
+        if (end - *p < 4)
+            return false;
+        *p += 4;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Grava direto no buffer quando o pior caso cabe; senão monta em tmp e copia
+bool encodeSensorDataFast(uint8_t *buffer, size_t *length, const SensorData *data)
+{
+    uint8_t tmp[SensorData_size];
+    uint8_t *p = *length >= SensorData_size ? buffer : tmp;
+    size_t n = 0;
+
+    // Floats são omitidos só quando todos os bits são zero (-0.0 é enviado)
+    uint32_t temp = float_bits(data->temperature);
+    uint32_t hum = float_bits(data->humidity);
+
+    if (data->timestamp) {
+        p[n++] = FIELD_TAG(1, WIRE_VARINT);
+        n += put_varint(&p[n], data->timestamp);
+    }
+    if (temp) {
+        p[n++] = FIELD_TAG(2, WIRE_32BIT);
+        n += put_fixed32(&p[n], temp);
+    }
+    if (hum) {
+        p[n++] = FIELD_TAG(3, WIRE_32BIT);
+        n += put_fixed32(&p[n], hum);
+    }
+
+    if (p == tmp) {
+        if (n > *length)
+            return false;
+        memcpy(buffer, tmp, n);
+    }
+    *length = n;
+    return true;
+}
+
+bool decodeSensorDataFast(const uint8_t *buffer, size_t length, SensorData *data)
+{
+    const uint8_t *p = buffer;
+    const uint8_t *end = buffer + length;
+    SensorData out = SensorData_init_zero;
+
+    while (p < end) {
+        uint32_t key;
+        if (!get_key(&p, end, &key))
+            return false;
+
+        uint32_t field = key >> 3;
+        uint32_t wire = key & 7;
+        uint32_t bits;
+
+        if (field == 1 && wire == WIRE_VARINT) {
+            if (!get_varint(&p, end, &out.timestamp))
+                return false;
+        } else if ((field == 2 || field == 3) && wire == WIRE_32BIT) {
+            if (!get_fixed32(&p, end, &bits))
+                return false;
+            memcpy(field == 2 ? &out.temperature : &out.humidity, &bits, sizeof(bits));
+        } else if (field >= 1 && field <= 3) {
+            return false; // Tipo de fio incompatível com o campo
+        } else if (field == 0 || !skip_field(&p, end, wire)) {
+            return false;
+        }
+    }
+
+    *data = out;
+    return true;
+}
+
+bool encodeLogControlFast(uint8_t *buffer, size_t *length, const LogControl *data)
+{
+    uint8_t tmp[LogControl_size];
+    uint8_t *p = *length >= LogControl_size ? buffer : tmp;
+    size_t n = 0;
+
+    if (data->command) {
+        p[n++] = FIELD_TAG(1, WIRE_VARINT);
+        n += put_varint(&p[n], (uint64_t)(int64_t)data->command);
+    }
+    if (data->length) {
+        p[n++] = FIELD_TAG(2, WIRE_VARINT);
+        n += put_varint(&p[n], data->length);
+    }
+    if (data->from_seq) {
+        p[n++] = FIELD_TAG(3, WIRE_VARINT);
+        n += put_varint(&p[n], data->from_seq);
+    }
+    if (data->from_time) {
+        p[n++] = FIELD_TAG(4, WIRE_VARINT);
+        n += put_varint(&p[n], data->from_time);
+    }
+    if (data->to_time) {
+        p[n++] = FIELD_TAG(5, WIRE_VARINT);
+        n += put_varint(&p[n], data->to_time);
+    }
+
+    if (p == tmp) {
+        if (n > *length)
+            return false;
+        memcpy(buffer, tmp, n);
+    }
+    *length = n;
+    return true;
+}
+
+bool decodeLogControlFast(const uint8_t *buffer, size_t length, LogControl *data)
+{
+    const uint8_t *p = buffer;
+    const uint8_t *end = buffer + length;
+    LogControl out = LogControl_init_zero;
+
+    while (p < end) {
+        uint32_t key;
+        if (!get_key(&p, end, &key))
+            return false;
+
+        uint32_t field = key >> 3;
+        uint32_t wire = key & 7;
+        uint64_t v;
+
+        if (field >= 1 && field <= 5 && wire == WIRE_VARINT) {
+            if (!get_varint(&p, end, &v))
+                return false;
+            if (field <= 3 && v > UINT32_MAX)
+                return false;
+            if (field == 1)
+                out.command = (LogControl_Command)(uint32_t)v;
+            else if (field == 2)
+                out.length = (uint32_t)v;
+            else if (field == 3)
+                out.from_seq = (uint32_t)v;
+            else if (field == 4)
+                out.from_time = v;
+            else
+                out.to_time = v;
+        } else if (field >= 1 && field <= 5) {
+            return false;
+        } else if (field == 0 || !skip_field(&p, end, wire)) {
+            return false;
+        }
+    }
+
+    *data = out;
+    return true;
+}
+
 // ==============================
 // Serialização Protobuf
 // ==============================
@@ -19,13 +316,17 @@ bool serializeSensorData(uint8_t *buffer, size_t *length, float temp, float hum)
         return false;
     }
 
-    pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
     SensorData data = SensorData_init_zero;
 
-    data.timestamp = esp_timer_get_time() / 1000000ULL + BUILD_UNIX_TIMESTAMP; // Em segundos
+    data.timestamp = getUnixTimestamp();
     data.temperature = temp;
     data.humidity = hum;
 
+#if SERIAL_FAST_CODEC
+    return serializeSensorDataFromStruct(buffer, length, &data);
+#else
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
+
     if (!pb_encode(&stream, SensorData_fields, &data)) {
         ESP_LOGE(TAG, "Erro na serialização SensorData: %s", PB_GET_ERROR(&stream));
         return false;
@@ -33,6 +334,7 @@ bool serializeSensorData(uint8_t *buffer, size_t *length, float temp, float hum)
 
     *length = stream.bytes_written;
     return true;
+#endif
 }
 
 // --- SensorData a partir de estrutura existente (preserva timestamp) ---
@@ -42,6 +344,13 @@ bool serializeSensorDataFromStruct(uint8_t *buffer, size_t *length, const Sensor
         return false;
     }
 
+#if SERIAL_FAST_CODEC
+    if (!encodeSensorDataFast(buffer, length, data_in)) {
+        ESP_LOGE(TAG, "Erro na serialização SensorData (from struct): buffer pequeno");
+        return false;
+    }
+    return true;
+#else
     pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
 
     if (!pb_encode(&stream, SensorData_fields, data_in)) {
@@ -51,6 +360,7 @@ bool serializeSensorDataFromStruct(uint8_t *buffer, size_t *length, const Sensor
 
     *length = stream.bytes_written;
     return true;
+#endif
 }
 
 bool deserializeSensorData(const uint8_t *buffer, size_t length, SensorData *data) {
@@ -59,6 +369,13 @@ bool deserializeSensorData(const uint8_t *buffer, size_t length, SensorData *dat
         return false;
     }
 
+#if SERIAL_FAST_CODEC
+    if (!decodeSensorDataFast(buffer, length, data)) {
+        ESP_LOGE(TAG, "Erro na desserialização SensorData");
+        return false;
+    }
+    return true;
+#else
     pb_istream_t stream = pb_istream_from_buffer(buffer, length);
     if (!pb_decode(&stream, SensorData_fields, data)) {
         ESP_LOGE(TAG, "Erro na desserialização SensorData: %s", PB_GET_ERROR(&stream));
@@ -66,6 +383,170 @@ bool deserializeSensorData(const uint8_t *buffer, size_t length, SensorData *dat
     }
 
     return true;
+#endif
+}
+
+// --- Quantização ---
+int32_t quantizeCenti(float value) {
+    if (isnan(value))
+        return 0;
+    float centi = value * 100.0f;
+    if (centi >= (float)INT32_MAX)
+        return INT32_MAX;
+    if (centi <= (float)INT32_MIN)
+        return INT32_MIN;
+    return (int32_t)lroundf(centi);
+}
+
+float dequantizeCenti(int32_t centi) {
+    return (float)centi / 100.0f;
+}
+
+// --- SensorDataBatch (lotes de log) ---
+#define BATCH_MAX_RECORDS (sizeof(((SensorDataBatch *)0)->temperatures) / sizeof(int32_t))
+
+// Desvio do registro i em relação à grade base + i * interval
+static int32_t batch_delta(const SensorData *items, size_t i, uint32_t interval) {
+    int64_t delta = (int64_t)(items[i].timestamp - items[0].timestamp) - (int64_t)i * interval;
+    if (delta > INT32_MAX)
+        return INT32_MAX;
+    if (delta < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t)delta;
+}
+
+#if SERIAL_FAST_CODEC
+// Campo repetido compactado: tag + tamanho + valores
+static size_t packed_field_size(size_t payload) {
+    return payload ? 1 + varint_size(payload) + payload : 0;
+}
+
+static size_t put_packed_sint32(uint8_t *p, uint32_t field, size_t payload, const SensorData *items, size_t count,
+                                uint32_t interval) {
+    size_t n = 0;
+    p[n++] = FIELD_TAG(field, WIRE_LEN);
+    n += put_varint(&p[n], payload);
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = field == SensorDataBatch_delta_timestamps_tag ? batch_delta(items, i, interval)
+                  : field == SensorDataBatch_temperatures_tag     ? quantizeCenti(items[i].temperature)
+                                                                 : quantizeCenti(items[i].humidity);
+        n += put_varint(&p[n], zigzag32(v));
+    }
+    return n;
+}
+#endif
+
+size_t serializeSensorDataBatch(uint8_t *buffer, size_t *length, const SensorData *items, const uint32_t *seqs,
+                                size_t count, uint32_t interval) {
+    if (!buffer || !length || !items) {
+        ESP_LOGE(TAG, "Parâmetros inválidos em serializeSensorDataBatch");
+        return 0;
+    }
+
+    if (count > BATCH_MAX_RECORDS)
+        count = BATCH_MAX_RECORDS;
+
+    // seq[i] = first_seq + i: o lote termina no primeiro salto de seq
+    uint32_t first_seq = seqs ? seqs[0] : 0;
+    if (seqs) {
+        for (size_t i = 1; i < count; i++) {
+            if (seqs[i] != first_seq + i) {
+                count = i;
+                break;
+            }
+        }
+    }
+
+    if (count == 0) {
+        *length = 0;
+        return 0;
+    }
+
+#if SERIAL_FAST_CODEC
+    // Primeira passada: quantos registros cabem (o cabeçalho e os prefixos de
+    // tamanho dependem dos próprios registros)
+    uint64_t base = items[0].timestamp;
+    size_t header = (base ? 1 + varint_size(base) : 0) + (interval ? 1 + varint_size(interval) : 0) +
+                    (first_seq ? 1 + varint_size(first_seq) : 0);
+    size_t ts_len = 0, temp_len = 0, hum_len = 0;
+    size_t packed = 0;
+
+    while (packed < count) {
+        size_t ts = ts_len + varint_size(zigzag32(batch_delta(items, packed, interval)));
+        size_t temp = temp_len + varint_size(zigzag32(quantizeCenti(items[packed].temperature)));
+        size_t hum = hum_len + varint_size(zigzag32(quantizeCenti(items[packed].humidity)));
+
+        if (header + packed_field_size(ts) + packed_field_size(temp) + packed_field_size(hum) > *length)
+            break;
+
+        ts_len = ts;
+        temp_len = temp;
+        hum_len = hum;
+        packed++;
+    }
+
+    if (packed == 0) {
+        *length = 0;
+        return 0;
+    }
+
+    // Segunda passada: grava
+    size_t n = 0;
+    if (base) {
+        buffer[n++] = FIELD_TAG(SensorDataBatch_base_timestamp_tag, WIRE_VARINT);
+        n += put_varint(&buffer[n], base);
+    }
+    if (interval) {
+        buffer[n++] = FIELD_TAG(SensorDataBatch_interval_tag, WIRE_VARINT);
+        n += put_varint(&buffer[n], interval);
+    }
+    n += put_packed_sint32(&buffer[n], SensorDataBatch_delta_timestamps_tag, ts_len, items, packed, interval);
+    n += put_packed_sint32(&buffer[n], SensorDataBatch_temperatures_tag, temp_len, items, packed, interval);
+    n += put_packed_sint32(&buffer[n], SensorDataBatch_humidities_tag, hum_len, items, packed, interval);
+    if (first_seq) {
+        buffer[n++] = FIELD_TAG(SensorDataBatch_first_seq_tag, WIRE_VARINT);
+        n += put_varint(&buffer[n], first_seq);
+    }
+
+    *length = n;
+    return packed;
+#else
+    static SensorDataBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.base_timestamp = items[0].timestamp;
+    batch.interval = interval;
+    batch.first_seq = first_seq;
+
+    // Acrescenta registros enquanto o lote codificado couber
+    size_t packed = 0;
+    while (packed < count) {
+        batch.delta_timestamps[packed] = batch_delta(items, packed, interval);
+        batch.temperatures[packed] = quantizeCenti(items[packed].temperature);
+        batch.humidities[packed] = quantizeCenti(items[packed].humidity);
+        batch.delta_timestamps_count = batch.temperatures_count = batch.humidities_count = (pb_size_t)(packed + 1);
+
+        size_t size = 0;
+        if (!pb_get_encoded_size(&size, SensorDataBatch_fields, &batch) || size > *length)
+            break;
+        packed++;
+    }
+
+    batch.delta_timestamps_count = batch.temperatures_count = batch.humidities_count = (pb_size_t)packed;
+    if (packed == 0) {
+        *length = 0;
+        return 0;
+    }
+
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
+    if (!pb_encode(&stream, SensorDataBatch_fields, &batch)) {
+        ESP_LOGE(TAG, "Erro na serialização SensorDataBatch: %s", PB_GET_ERROR(&stream));
+        *length = 0;
+        return 0;
+    }
+
+    *length = stream.bytes_written;
+    return packed;
+#endif
 }
 
 // --- SensorConfig ---
@@ -76,6 +557,8 @@ bool serializeSensorConfig(uint8_t *buffer, size_t *len, const SensorConfig *cfg
     proto.log_mode = cfg->log_mode;
     proto.date_time_init = cfg->date_time_init;
     proto.date_time_stop = cfg->date_time_stop;
+    proto.repeatability = cfg->repeatability;
+    proto.beacon = cfg->beacon;
 
     pb_ostream_t stream = pb_ostream_from_buffer(buffer, *len);
     if (!pb_encode(&stream, SensorConfig_fields, &proto))
@@ -107,12 +590,20 @@ bool serializeLogControl(uint8_t *buffer, size_t *length, LogControl_Command com
         return false;
     }
 
-    pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
     LogControl data = LogControl_init_zero;
 
     data.command = command;
     data.length = length_val;
 
+#if SERIAL_FAST_CODEC
+    if (!encodeLogControlFast(buffer, length, &data)) {
+        ESP_LOGE(TAG, "Erro na serialização LogControl: buffer pequeno");
+        return false;
+    }
+    return true;
+#else
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, *length);
+
     if (!pb_encode(&stream, LogControl_fields, &data)) {
         ESP_LOGE(TAG, "Erro na serialização LogControl: %s", PB_GET_ERROR(&stream));
         return false;
@@ -120,6 +611,7 @@ bool serializeLogControl(uint8_t *buffer, size_t *length, LogControl_Command com
 
     *length = stream.bytes_written;
     return true;
+#endif
 }
 
 bool deserializeLogControl(const uint8_t *buffer, size_t length, LogControl *data) {
@@ -128,6 +620,13 @@ bool deserializeLogControl(const uint8_t *buffer, size_t length, LogControl *dat
         return false;
     }
 
+#if SERIAL_FAST_CODEC
+    if (!decodeLogControlFast(buffer, length, data)) {
+        ESP_LOGE(TAG, "Erro na desserialização LogControl");
+        return false;
+    }
+    return true;
+#else
     pb_istream_t stream = pb_istream_from_buffer(buffer, length);
     if (!pb_decode(&stream, LogControl_fields, data)) {
         ESP_LOGE(TAG, "Erro na desserialização LogControl: %s", PB_GET_ERROR(&stream));
@@ -135,4 +634,5 @@ bool deserializeLogControl(const uint8_t *buffer, size_t length, LogControl *dat
     }
 
     return true;
+#endif
 }
@@ -6,14 +6,39 @@
 #include "sensor.pb.h"
 #include "pb_encode.h"
 #include "pb_decode.h"
-#include "esp_timer.h"
-#include "esp_log.h"
+
+// Codec especializado para SensorData/LogControl (mesmo formato de fio do
+// nanopb, em código linear). Com 0, tudo passa pelo pb_encode/pb_decode.
+#ifndef SERIAL_FAST_CODEC
+#define SERIAL_FAST_CODEC 1
+#endif
+
+// Timestamp Unix atual (em segundos)
+uint64_t getUnixTimestamp(void);
+uint64_t getUnixTimeUs(void);
 
 // SensorData
 bool serializeSensorData(uint8_t *buffer, size_t *length, float temp, float hum);
 bool serializeSensorDataFromStruct(uint8_t *buffer, size_t *length, const SensorData *data);
 bool deserializeSensorData(const uint8_t *buffer, size_t length, SensorData *data);
 
+// Quantização usada no log e nos lotes (centésimos de °C / %UR)
+int32_t quantizeCenti(float value);
+float dequantizeCenti(int32_t centi);
+
+// SensorDataBatch a partir de registros do log. Empacota o máximo de registros
+// que couber em *length (até o limite do lote); retorna quantos foram
+// empacotados e atualiza *length com os bytes escritos. Com seqs (opcional, o
+// seq de cada registro), o lote leva first_seq e para no primeiro salto de seq.
+size_t serializeSensorDataBatch(uint8_t *buffer, size_t *length, const SensorData *items, const uint32_t *seqs,
+                                size_t count, uint32_t interval);
+
+// Codec especializado (usado pelas funções acima quando SERIAL_FAST_CODEC = 1)
+bool encodeSensorDataFast(uint8_t *buffer, size_t *length, const SensorData *data);
+bool decodeSensorDataFast(const uint8_t *buffer, size_t length, SensorData *data);
+bool encodeLogControlFast(uint8_t *buffer, size_t *length, const LogControl *data);
+bool decodeLogControlFast(const uint8_t *buffer, size_t length, LogControl *data);
+
 // SensorConfig
 bool serializeSensorConfig(uint8_t *buffer, size_t *len, const SensorConfig *cfg);
 bool deserializeSensorConfig(const uint8_t *buffer, size_t length, SensorConfig *data);
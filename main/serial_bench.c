@@ -0,0 +1,295 @@
+#include "serial_bench.h"
+#include "serial.h"
+#include <math.h>
+#include <string.h>
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "SERIAL_BENCH";
+
+// Impede que o compilador descarte resultados não usados
+static volatile size_t bench_sink;
+
+// ==========================
+// Medição
+// ==========================
+typedef size_t (*bench_fn_t)(void);
+
+static void bench_run_one(const char *name, bench_fn_t fn)
+{
+    fn(); // Aquecimento (cache de instruções/flash)
+
+    size_t bytes = 0;
+    uint32_t cycles_start = esp_cpu_get_cycle_count();
+    int64_t start_us = esp_timer_get_time();
+
+    for (uint32_t i = 0; i < SERIAL_BENCH_ITERATIONS; i++)
+        bytes += fn();
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    uint32_t cycles = esp_cpu_get_cycle_count() - cycles_start;
+
+    bench_sink = bytes;
+    ESP_LOGI(TAG, "BENCH,%s,%u,%llu,%lu,%u", name, (unsigned)SERIAL_BENCH_ITERATIONS,
+             (unsigned long long)(elapsed_us * 1000 / SERIAL_BENCH_ITERATIONS),
+             (unsigned long)(cycles / SERIAL_BENCH_ITERATIONS),
+             (unsigned)(bytes / SERIAL_BENCH_ITERATIONS));
+}
+
+// ==========================
+// Entradas realistas
+// ==========================
+static const SensorData bench_sample = {
+    .timestamp = 1752330283ULL,
+    .temperature = 23.47f,
+    .humidity = 61.2f,
+};
+
+static const SensorConfig bench_config = {
+    .interval = 60,
+    .log_mode = true,
+    .date_time_init = 1752330283ULL,
+    .date_time_stop = 1752416683ULL,
+    .repeatability = SensorConfig_Repeatability_HIGH,
+};
+
+static uint8_t bench_buf[256];
+static uint8_t bench_sensor_pb[SensorData_size];
+static size_t bench_sensor_pb_len;
+static uint8_t bench_ctrl_pb[LogControl_size];
+static size_t bench_ctrl_pb_len;
+static SensorData bench_batch[64];
+static uint32_t bench_seqs[64];
+
+// ==========================
+// Casos
+// ==========================
+static size_t bench_serialize_sensor_data(void)
+{
+    size_t len = sizeof(bench_buf);
+    serializeSensorData(bench_buf, &len, bench_sample.temperature, bench_sample.humidity);
+    return len;
+}
+
+static size_t bench_serialize_sensor_data_from_struct(void)
+{
+    size_t len = sizeof(bench_buf);
+    serializeSensorDataFromStruct(bench_buf, &len, &bench_sample);
+    return len;
+}
+
+static size_t bench_deserialize_sensor_data(void)
+{
+    SensorData data;
+    deserializeSensorData(bench_sensor_pb, bench_sensor_pb_len, &data);
+    return bench_sensor_pb_len;
+}
+
+// Um lote do tamanho de uma notificação (MTU 247)
+static size_t bench_serialize_sensor_data_batch(void)
+{
+    size_t len = 244;
+    serializeSensorDataBatch(bench_buf, &len, bench_batch, bench_seqs, sizeof(bench_batch) / sizeof(bench_batch[0]), 60);
+    return len;
+}
+
+static size_t bench_serialize_sensor_config(void)
+{
+    size_t len = sizeof(bench_buf);
+    serializeSensorConfig(bench_buf, &len, &bench_config);
+    return len;
+}
+
+static size_t bench_serialize_log_control(void)
+{
+    size_t len = sizeof(bench_buf);
+    serializeLogControl(bench_buf, &len, LogControl_Command_GETLENGTH, 12345);
+    return len;
+}
+
+static size_t bench_deserialize_log_control(void)
+{
+    LogControl data;
+    deserializeLogControl(bench_ctrl_pb, bench_ctrl_pb_len, &data);
+    return bench_ctrl_pb_len;
+}
+
+// ==========================
+// Equivalência do codec especializado com o nanopb
+// ==========================
+// Codifica/decodifica pelos dois caminhos e compara bytes e campos. Cobre
+// campos zerados (omitidos no proto3), -0.0, NaN e timestamps de 1 a 10 bytes.
+static bool bench_verify_sensor_data(const SensorData *in)
+{
+    uint8_t ref[SensorData_size];
+    uint8_t fast[SensorData_size];
+    size_t fast_len = sizeof(fast);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(ref, sizeof(ref));
+    if (!pb_encode(&stream, SensorData_fields, in) || !encodeSensorDataFast(fast, &fast_len, in))
+        return false;
+    if (stream.bytes_written != fast_len || memcmp(ref, fast, fast_len) != 0)
+        return false;
+
+    SensorData a = SensorData_init_zero;
+    SensorData b = SensorData_init_zero;
+    pb_istream_t istream = pb_istream_from_buffer(ref, fast_len);
+    if (!pb_decode(&istream, SensorData_fields, &a) || !decodeSensorDataFast(ref, fast_len, &b))
+        return false;
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static bool bench_verify_log_control(const LogControl *in)
+{
+    uint8_t ref[LogControl_size];
+    uint8_t fast[LogControl_size];
+    size_t fast_len = sizeof(fast);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(ref, sizeof(ref));
+    if (!pb_encode(&stream, LogControl_fields, in) || !encodeLogControlFast(fast, &fast_len, in))
+        return false;
+    if (stream.bytes_written != fast_len || memcmp(ref, fast, fast_len) != 0)
+        return false;
+
+    LogControl a = LogControl_init_zero;
+    LogControl b = LogControl_init_zero;
+    pb_istream_t istream = pb_istream_from_buffer(ref, fast_len);
+    if (!pb_decode(&istream, LogControl_fields, &a) || !decodeLogControlFast(ref, fast_len, &b))
+        return false;
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// O lote decodificado pelo nanopb deve reproduzir os registros quantizados
+// (e seus seq) até o primeiro salto de seq
+static bool bench_verify_batch(const SensorData *items, const uint32_t *seqs, size_t count, uint32_t interval,
+                               size_t expected)
+{
+    static uint8_t buf[SensorDataBatch_size];
+    static SensorDataBatch batch;
+    size_t len = sizeof(buf);
+
+    size_t packed = serializeSensorDataBatch(buf, &len, items, seqs, count, interval);
+    if (packed != expected)
+        return false;
+
+    memset(&batch, 0, sizeof(batch));
+    pb_istream_t istream = pb_istream_from_buffer(buf, len);
+    if (!pb_decode(&istream, SensorDataBatch_fields, &batch) || batch.temperatures_count != packed ||
+        batch.humidities_count != packed || batch.delta_timestamps_count != packed ||
+        batch.first_seq != (seqs ? seqs[0] : 0))
+        return false;
+
+    for (size_t i = 0; i < packed; i++)
+    {
+        uint64_t ts = batch.base_timestamp + (uint64_t)i * batch.interval + (int64_t)batch.delta_timestamps[i];
+        if (ts != items[i].timestamp || batch.temperatures[i] != quantizeCenti(items[i].temperature) ||
+            batch.humidities[i] != quantizeCenti(items[i].humidity))
+            return false;
+    }
+    return true;
+}
+
+static bool serial_bench_verify(void)
+{
+    static const float floats[] = {0.0f, -0.0f, 23.47f, -40.0f, 100.0f, NAN, INFINITY};
+    uint32_t cases = 0;
+    uint32_t failures = 0;
+
+    for (unsigned shift = 0; shift <= 64; shift += 7)
+    {
+        uint64_t ts = shift == 0 ? 0 : (shift >= 64 ? UINT64_MAX : (1ULL << shift) - 1);
+        for (size_t t = 0; t < sizeof(floats) / sizeof(floats[0]); t++)
+        {
+            for (size_t h = 0; h < sizeof(floats) / sizeof(floats[0]); h++)
+            {
+                SensorData data = {.timestamp = ts, .temperature = floats[t], .humidity = floats[h]};
+                cases++;
+                if (!bench_verify_sensor_data(&data))
+                    failures++;
+            }
+        }
+    }
+
+    static const uint32_t lengths[] = {0, 1, 127, 128, 16383, 16384, UINT32_MAX};
+    for (int cmd = _LogControl_Command_MIN; cmd <= _LogControl_Command_MAX; cmd++)
+    {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+        {
+            LogControl ctrl = {
+                .command = (LogControl_Command)cmd,
+                .length = lengths[l],
+                .from_seq = lengths[(l + 1) % (sizeof(lengths) / sizeof(lengths[0]))],
+                .from_time = l ? UINT64_MAX >> (9 * l) : 0,
+                .to_time = (uint64_t)lengths[l] << 32,
+            };
+            cases++;
+            if (!bench_verify_log_control(&ctrl))
+                failures++;
+        }
+    }
+
+    // Lotes regulares, com atrasos e com timestamps fora de ordem
+    for (uint32_t interval = 0; interval <= 3600; interval += 1200)
+    {
+        for (size_t i = 0; i < sizeof(bench_batch) / sizeof(bench_batch[0]); i++)
+            bench_batch[i].timestamp = bench_sample.timestamp + i * interval + (i % 9 == 0 ? 3 : 0) - (i == 5 ? 7200 : 0);
+
+        cases++;
+        if (!bench_verify_batch(bench_batch, NULL, sizeof(bench_batch) / sizeof(bench_batch[0]), interval, 64))
+            failures++;
+    }
+
+    // first_seq e corte no primeiro salto de seq (registro inválido pulado)
+    for (size_t i = 0; i < sizeof(bench_seqs) / sizeof(bench_seqs[0]); i++)
+        bench_seqs[i] = 1000 + i + (i >= 40 ? 1 : 0);
+    cases++;
+    if (!bench_verify_batch(bench_batch, bench_seqs, sizeof(bench_batch) / sizeof(bench_batch[0]), 60, 40))
+        failures++;
+
+    if (failures)
+        ESP_LOGE(TAG, "Codec especializado difere do nanopb em %lu de %lu casos",
+                 (unsigned long)failures, (unsigned long)cases);
+    else
+        ESP_LOGI(TAG, "Codec especializado equivalente ao nanopb (%lu casos)", (unsigned long)cases);
+
+    return failures == 0;
+}
+
+// ==========================
+// Execução
+// ==========================
+void serial_bench_run(void)
+{
+    bench_sensor_pb_len = sizeof(bench_sensor_pb);
+    serializeSensorDataFromStruct(bench_sensor_pb, &bench_sensor_pb_len, &bench_sample);
+
+    bench_ctrl_pb_len = sizeof(bench_ctrl_pb);
+    serializeLogControl(bench_ctrl_pb, &bench_ctrl_pb_len, LogControl_Command_GETLENGTH, 12345);
+
+    for (size_t i = 0; i < sizeof(bench_batch) / sizeof(bench_batch[0]); i++)
+    {
+        bench_batch[i] = bench_sample;
+        bench_batch[i].timestamp += i * 60;
+        bench_batch[i].temperature += (float)(i % 7) * 0.01f;
+        bench_batch[i].humidity -= (float)(i % 5) * 0.1f;
+    }
+
+    serial_bench_verify();
+
+    for (size_t i = 0; i < sizeof(bench_batch) / sizeof(bench_batch[0]); i++)
+    {
+        bench_batch[i].timestamp = bench_sample.timestamp + i * 60;
+        bench_seqs[i] = 1000 + i;
+    }
+
+    ESP_LOGI(TAG, "BENCH,funcao,iteracoes,ns_op,ciclos_op,bytes_op");
+    bench_run_one("serializeSensorData", bench_serialize_sensor_data);
+    bench_run_one("serializeSensorDataFromStruct", bench_serialize_sensor_data_from_struct);
+    bench_run_one("deserializeSensorData", bench_deserialize_sensor_data);
+    bench_run_one("serializeSensorDataBatch_244B", bench_serialize_sensor_data_batch);
+    bench_run_one("serializeSensorConfig", bench_serialize_sensor_config);
+    bench_run_one("serializeLogControl", bench_serialize_log_control);
+    bench_run_one("deserializeLogControl", bench_deserialize_log_control);
+    ESP_LOGI(TAG, "Codec SensorData/LogControl: %s", SERIAL_FAST_CODEC ? "especializado" : "nanopb");
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// ==========================
+// Micro-benchmark da serialização (serial.c)
+// ==========================
+// Desligado por padrão. Com SERIAL_BENCH_ENABLE = 1 o app_main roda o
+// benchmark uma vez antes de iniciar sensor e BLE, precedido de uma
+// verificação de equivalência do codec especializado contra o nanopb. Cada função gera uma linha
+// no log, em formato fixo para ser extraída do monitor serial:
+//
+//   BENCH,<função>,<iterações>,<ns/op>,<ciclos/op>,<bytes/op>
+
+#ifndef SERIAL_BENCH_ENABLE
+#define SERIAL_BENCH_ENABLE 0
+#endif
+
+#define SERIAL_BENCH_ITERATIONS 10000
+
+void serial_bench_run(void);
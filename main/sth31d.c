@@ -1,46 +1,146 @@
 #include <stdio.h>
-#include "driver/i2c.h"
+#include <string.h>
+#include "sth31d.h"
+#include "driver/i2c_master.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #define I2C_MASTER_NUM             I2C_NUM_0
 #define I2C_MASTER_SCL_IO          9
 #define I2C_MASTER_SDA_IO          8
 #define I2C_MASTER_FREQ_HZ         100000
-#define I2C_MASTER_TX_BUF_DISABLE  0
-#define I2C_MASTER_RX_BUF_DISABLE  0
+#define I2C_MASTER_QUEUE_DEPTH     2 // > 0 habilita transações assíncronas
+#define I2C_MASTER_TIMEOUT_MS      100
 #define STH31_SENSOR_ADDR          0x44
 
+// Política de novas tentativas
+#define STH31_MAX_RETRIES          2
+#define STH31_BACKOFF_MS           5 // Dobra a cada tentativa (single shot)
+
+// Comandos (datasheet SHT3x-DIS)
+#define STH31_CMD_FETCH_DATA       0xE000
+#define STH31_CMD_BREAK            0x3093
+#define STH31_CMD_ART              0x2B32
+
 static const char *TAG = "STH31";
 static bool i2c_initialized = false;
 
-esp_err_t i2c_master_init_once(void) {
+// Barramento e dispositivo criados uma única vez
+static i2c_master_bus_handle_t bus_handle = NULL;
+static i2c_master_dev_handle_t dev_handle = NULL;
+
+// Conclusão das transações assíncronas (sinalizada pelo callback do driver)
+static SemaphoreHandle_t trans_done = NULL;
+static volatile i2c_master_event_t trans_event;
+
+// Buffers estáticos: precisam continuar válidos até o fim da transação assíncrona
+static uint8_t tx_buf[2];
+static uint8_t rx_buf[6];
+
+// Single shot sem clock stretching: [repetibilidade]
+static const uint16_t single_shot_cmds[] = { 0x2400, 0x240B, 0x2416 };
+
+// Aquisição periódica: [mps][repetibilidade]
+static const uint16_t periodic_cmds[][3] = {
+    [STH31_MPS_0_5] = { 0x2032, 0x2024, 0x202F },
+    [STH31_MPS_1]   = { 0x2130, 0x2126, 0x212D },
+    [STH31_MPS_2]   = { 0x2236, 0x2220, 0x222B },
+    [STH31_MPS_4]   = { 0x2334, 0x2322, 0x2329 },
+    [STH31_MPS_10]  = { 0x2737, 0x2721, 0x272A },
+};
+
+// Período de cada modo periódico (ms)
+static const uint32_t periodic_period_ms[] = {
+    [STH31_MPS_0_5] = 2000,
+    [STH31_MPS_1]   = 1000,
+    [STH31_MPS_2]   = 500,
+    [STH31_MPS_4]   = 250,
+    [STH31_MPS_10]  = 100,
+    [STH31_MPS_ART] = 250,
+};
+
+// CRC-8 do SHT3x: polinômio 0x31, valor inicial 0xFF. A tabela é gerada pelo
+// pré-processador, em tempo de compilação.
+#define CRC8_POLY 0x31
+#define CRC8_INIT 0xFF
+#define CRC8_BIT(c) (((c) << 1) ^ (((c) & 0x80) ? CRC8_POLY : 0))
+#define CRC8_ENTRY(i) ((uint8_t)CRC8_BIT(CRC8_BIT(CRC8_BIT(CRC8_BIT(CRC8_BIT(CRC8_BIT(CRC8_BIT(CRC8_BIT(i)))))))))
+#define CRC8_ROW4(i) CRC8_ENTRY(i), CRC8_ENTRY((i) + 1), CRC8_ENTRY((i) + 2), CRC8_ENTRY((i) + 3)
+#define CRC8_ROW16(i) CRC8_ROW4(i), CRC8_ROW4((i) + 4), CRC8_ROW4((i) + 8), CRC8_ROW4((i) + 12)
+#define CRC8_ROW64(i) CRC8_ROW16(i), CRC8_ROW16((i) + 16), CRC8_ROW16((i) + 32), CRC8_ROW16((i) + 48)
+
+static const uint8_t crc8_table[256] = {
+    CRC8_ROW64(0), CRC8_ROW64(64), CRC8_ROW64(128), CRC8_ROW64(192),
+};
+
+_Static_assert(CRC8_ENTRY(0x01) == 0x31, "tabela CRC-8 inválida");
+
+static sth31_stats_t stats;
+
+static sth31_repeatability_t single_shot_repeatability = STH31_REPEATABILITY_HIGH;
+static bool periodic_active = false;
+static sth31_mps_t periodic_mps;
+static int64_t periodic_start_us = 0;
+static bool periodic_first_fetch = false;
+
+// Roda em ISR ao fim de cada transação
+static bool IRAM_ATTR i2c_trans_done_cb(i2c_master_dev_handle_t i2c_dev,
+                                        const i2c_master_event_data_t *evt_data, void *arg) {
+    BaseType_t woken = pdFALSE;
+    trans_event = evt_data->event;
+    xSemaphoreGiveFromISR(trans_done, &woken);
+    return woken == pdTRUE;
+}
+
+static esp_err_t i2c_master_init_once(void) {
     if (i2c_initialized) return ESP_OK;
 
-    i2c_config_t config = {
-        .mode = I2C_MODE_MASTER,
+    ESP_LOGI(TAG, "Configurando I2C...");
+    esp_err_t err;
+
+    trans_done = xSemaphoreCreateBinary();
+    if (!trans_done) return ESP_ERR_NO_MEM;
+
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = I2C_MASTER_NUM,
         .sda_io_num = I2C_MASTER_SDA_IO,
         .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = I2C_MASTER_QUEUE_DEPTH,
+        .flags.enable_internal_pullup = true,
     };
 
-    ESP_LOGI(TAG, "Configurando I2C...");
-    esp_err_t err;
+    err = i2c_new_master_bus(&bus_config, &bus_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Erro ao criar barramento I2C: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = STH31_SENSOR_ADDR,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ,
+    };
 
-    err = i2c_param_config(I2C_MASTER_NUM, &config);
+    err = i2c_master_bus_add_device(bus_handle, &dev_config, &dev_handle);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Erro ao configurar I2C: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Erro ao adicionar STH31 ao barramento: %s", esp_err_to_name(err));
         return err;
     }
 
-    err = i2c_driver_install(I2C_MASTER_NUM, config.mode, 
-                             I2C_MASTER_RX_BUF_DISABLE, 
-                             I2C_MASTER_TX_BUF_DISABLE, 0);
+    i2c_master_event_callbacks_t cbs = {
+        .on_trans_done = i2c_trans_done_cb,
+    };
+
+    err = i2c_master_register_event_callbacks(dev_handle, &cbs, NULL);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Erro ao instalar driver I2C: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Erro ao registrar callbacks I2C: %s", esp_err_to_name(err));
         return err;
     }
 
@@ -49,53 +149,182 @@ esp_err_t i2c_master_init_once(void) {
     return ESP_OK;
 }
 
-esp_err_t sth31_get_temp_hum(float *temperature, float *humidity) {
-    if (!temperature || !humidity) return ESP_ERR_INVALID_ARG;
+// Aguarda o callback de fim de transação; a task fica bloqueada (CPU livre para dormir)
+static esp_err_t sth31_wait_done(void) {
+    if (xSemaphoreTake(trans_done, pdMS_TO_TICKS(I2C_MASTER_TIMEOUT_MS)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
 
+    return trans_event == I2C_EVENT_DONE ? ESP_OK : ESP_FAIL;
+}
+
+// Envia um comando de 16 bits ao sensor
+static esp_err_t sth31_write_cmd(uint16_t command) {
     esp_err_t ret = i2c_master_init_once();
     if (ret != ESP_OK) return ret;
 
-    //ESP_LOGI(TAG, "Iniciando leitura do sensor");
-
-    // Comando de medição simples (high repeatability, clock stretching disabled)
-    uint8_t cmd[] = { 0x24, 0x00 };
-    i2c_cmd_handle_t cmd_handle = i2c_cmd_link_create();
-    i2c_master_start(cmd_handle);
-    i2c_master_write_byte(cmd_handle, (STH31_SENSOR_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write(cmd_handle, cmd, sizeof(cmd), true);
-    i2c_master_stop(cmd_handle);
-    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd_handle, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd_handle);
+    tx_buf[0] = command >> 8;
+    tx_buf[1] = command & 0xFF;
+
+    ret = i2c_master_transmit(dev_handle, tx_buf, sizeof(tx_buf), I2C_MASTER_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+
+    return sth31_wait_done();
+}
+
+// Lê 6 bytes (Temp[2] + CRC + Hum[2] + CRC)
+static esp_err_t sth31_read_raw(uint8_t data[6]) {
+    esp_err_t ret = i2c_master_receive(dev_handle, rx_buf, sizeof(rx_buf), I2C_MASTER_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+
+    ret = sth31_wait_done();
+    if (ret == ESP_OK)
+        memcpy(data, rx_buf, sizeof(rx_buf));
+
+    return ret;
+}
+
+// Espera de pelo menos ms milissegundos: arredonda para cima e nunca para zero
+// ticks (a 100 Hz, pdMS_TO_TICKS(5) é 0 e a task nem cederia a CPU)
+static void sth31_delay_ms(uint32_t ms) {
+    // vTaskDelay conta o tick corrente já em andamento: um tick a mais garante o mínimo
+    TickType_t ticks = (TickType_t)(((uint64_t)ms * configTICK_RATE_HZ + 999) / 1000);
+    vTaskDelay(ticks + 1);
+}
+
+// CRC-8 de uma palavra de 16 bits (datasheet: CRC(0xBEEF) = 0x92)
+static inline uint8_t sth31_crc8(const uint8_t word[2]) {
+    uint8_t crc = crc8_table[CRC8_INIT ^ word[0]];
+    return crc8_table[crc ^ word[1]];
+}
+
+esp_err_t sth31_start_periodic(sth31_mps_t mps, sth31_repeatability_t repeatability) {
+    if (mps > STH31_MPS_ART || repeatability > STH31_REPEATABILITY_LOW) return ESP_ERR_INVALID_ARG;
+
+    // Só é possível trocar de modo a partir do modo single shot
+    esp_err_t ret = sth31_stop_periodic();
+    if (ret != ESP_OK) return ret;
+
+    uint16_t command = (mps == STH31_MPS_ART) ? STH31_CMD_ART : periodic_cmds[mps][repeatability];
+    ret = sth31_write_cmd(command);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Erro ao iniciar modo periódico: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    periodic_active = true;
+    periodic_mps = mps;
+    periodic_start_us = esp_timer_get_time();
+    periodic_first_fetch = true;
+
+    ESP_LOGI(TAG, "Modo periódico iniciado (comando 0x%04X)", command);
+    return ESP_OK;
+}
+
+esp_err_t sth31_stop_periodic(void) {
+    if (!periodic_active) return ESP_OK;
+
+    esp_err_t ret = sth31_write_cmd(STH31_CMD_BREAK);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro ao enviar comando de medição: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Erro ao interromper modo periódico: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Espera pela conversão (~15ms típico, recomenda-se até 20ms)
-    vTaskDelay(pdMS_TO_TICKS(20));
+    periodic_active = false;
+    esp_rom_delay_us(1000); // Sensor volta ao modo single shot em até 1 ms (menos que um tick)
+    return ESP_OK;
+}
+
+bool sth31_is_periodic(void) {
+    return periodic_active;
+}
+
+void sth31_set_repeatability(sth31_repeatability_t repeatability) {
+    if (repeatability <= STH31_REPEATABILITY_LOW)
+        single_shot_repeatability = repeatability;
+}
+
+// Uma tentativa de leitura (sem novas tentativas)
+static esp_err_t sth31_read_once(float *temperature, float *humidity) {
+    esp_err_t ret;
+    if (periodic_active) {
+        // A primeira medição só fica pronta um período após o início do modo
+        if (periodic_first_fetch) {
+            int64_t ready_us = periodic_start_us + (int64_t)periodic_period_ms[periodic_mps] * 1000;
+            int64_t wait_us = ready_us - esp_timer_get_time();
+            if (wait_us > 0)
+                sth31_delay_ms((uint32_t)((wait_us + 999) / 1000));
+            periodic_first_fetch = false;
+        }
+
+        // Fetch Data: devolve o último resultado sem esperar conversão
+        ret = sth31_write_cmd(STH31_CMD_FETCH_DATA);
+    } else {
+        // Comando de medição simples (clock stretching disabled)
+        ret = sth31_write_cmd(single_shot_cmds[single_shot_repeatability]);
+    }
+    if (ret != ESP_OK) {
+        stats.i2c_errors++;
+        ESP_LOGW(TAG, "Erro ao enviar comando de medição: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (!periodic_active) {
+        // Espera pela conversão (~15ms típico, recomenda-se até 20ms)
+        sth31_delay_ms(20);
+    }
 
-    // Lê 6 bytes (Temp[2] + CRC + Hum[2] + CRC)
     uint8_t data[6];
-    i2c_cmd_handle_t read_handle = i2c_cmd_link_create();
-    i2c_master_start(read_handle);
-    i2c_master_write_byte(read_handle, (STH31_SENSOR_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read(read_handle, data, sizeof(data), I2C_MASTER_LAST_NACK);
-    i2c_master_stop(read_handle);
-    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, read_handle, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(read_handle);
+    ret = sth31_read_raw(data);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro ao ler dados do sensor: %s", esp_err_to_name(ret));
+        // Em modo periódico o sensor responde NACK se ainda não há medição nova
+        stats.i2c_errors++;
+        ESP_LOGW(TAG, "Erro ao ler dados do sensor: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Conversão sem verificação CRC
+    bool temp_ok = sth31_crc8(&data[0]) == data[2];
+    bool hum_ok = sth31_crc8(&data[3]) == data[5];
+    if (!temp_ok || !hum_ok) {
+        stats.crc_errors += !temp_ok + !hum_ok;
+        ESP_LOGW(TAG, "CRC inválido (temp %s, hum %s)", temp_ok ? "ok" : "erro", hum_ok ? "ok" : "erro");
+        return ESP_ERR_INVALID_CRC;
+    }
+
     uint16_t raw_temp = (data[0] << 8) | data[1];
     uint16_t raw_hum = (data[3] << 8) | data[4];
 
     *temperature = -45.0f + 175.0f * ((float)raw_temp / 65535.0f);
     *humidity = 100.0f * ((float)raw_hum / 65535.0f);
 
-    //ESP_LOGI(TAG, "Temp: %.2f °C | Hum: %.2f %%", *temperature, *humidity);
-
     return ESP_OK;
 }
+
+esp_err_t sth31_get_temp_hum(float *temperature, float *humidity) {
+    if (!temperature || !humidity) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt <= STH31_MAX_RETRIES; attempt++) {
+        if (attempt > 0) {
+            stats.retries++;
+
+            // Em modo periódico o resultado lido foi consumido: espera a próxima medição
+            uint32_t backoff_ms = periodic_active ? periodic_period_ms[periodic_mps]
+                                                  : ((uint32_t)STH31_BACKOFF_MS << (attempt - 1));
+            sth31_delay_ms(backoff_ms);
+        }
+
+        ret = sth31_read_once(temperature, humidity);
+        if (ret == ESP_OK) {
+            stats.reads_ok++;
+            return ESP_OK;
+        }
+    }
+
+    stats.failures++;
+    ESP_LOGE(TAG, "Leitura descartada após %d tentativas: %s", STH31_MAX_RETRIES + 1, esp_err_to_name(ret));
+    return ret;
+}
+
+void sth31_get_stats(sth31_stats_t *out) {
+    if (out) *out = stats;
+}
@@ -1,5 +1,46 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
 
-esp_err_t sth31_get_temp_hum(float *temperature, float *humidity);
\ No newline at end of file
+// Repetibilidade da medição (ruído x tempo de conversão)
+typedef enum {
+    STH31_REPEATABILITY_HIGH = 0,
+    STH31_REPEATABILITY_MEDIUM = 1,
+    STH31_REPEATABILITY_LOW = 2,
+} sth31_repeatability_t;
+
+// Modos de aquisição periódica (medições por segundo)
+typedef enum {
+    STH31_MPS_0_5 = 0,
+    STH31_MPS_1,
+    STH31_MPS_2,
+    STH31_MPS_4,
+    STH31_MPS_10,
+    STH31_MPS_ART, // Accelerated Response Time (4 Hz)
+} sth31_mps_t;
+
+// Em modo periódico a leitura é um único "Fetch Data", sem espera de conversão.
+// Fora dele é feita uma medição single shot (~15 ms).
+esp_err_t sth31_start_periodic(sth31_mps_t mps, sth31_repeatability_t repeatability);
+esp_err_t sth31_stop_periodic(void);
+bool sth31_is_periodic(void);
+
+// Repetibilidade usada nas medições single shot
+void sth31_set_repeatability(sth31_repeatability_t repeatability);
+
+// Lê temperatura e umidade validando o CRC-8 de cada palavra. Leituras com
+// erro de barramento ou CRC são repetidas até STH31_MAX_RETRIES vezes.
+esp_err_t sth31_get_temp_hum(float *temperature, float *humidity);
+
+// Contadores de leitura
+typedef struct {
+    uint32_t reads_ok;    // Leituras válidas entregues
+    uint32_t i2c_errors;  // Transações I2C com falha (inclui NACK)
+    uint32_t crc_errors;  // Palavras com CRC inválido
+    uint32_t retries;     // Novas tentativas feitas
+    uint32_t failures;    // Leituras abandonadas após todas as tentativas
+} sth31_stats_t;
+
+void sth31_get_stats(sth31_stats_t *stats);
@@ -1,17 +1,47 @@
 #include "temp_hum.h"
 #include "ble_live.h"
+#include "ble_gatt.h"
+#include "ble_adv.h"
 #include "ble_log.h"
 #include "sth31d.h"
 #include "nvs_controller.h"
+#include "serial.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
 
 static const char *TAG = "TEMP_HUM";
 
-static esp_timer_handle_t timer_handle;
+#define SENSOR_TASK_STACK_SIZE 3072
+#define SENSOR_TASK_PRIORITY 3
+
+// Acima deste intervalo o sensor fica em single shot: em modo periódico ele
+// faria dezenas de conversões por amostra gravada
+#define SENSOR_PERIODIC_MAX_INTERVAL_S 10
+
+// Dois timers: o one-shot dispara na fronteira do intervalo e arma o periódico
+static esp_timer_handle_t align_timer;
+static esp_timer_handle_t sample_timer;
+static _Atomic uint64_t sample_period_us = 0; // Período armado pelo one-shot
+static TaskHandle_t sensor_task_handle = NULL;
+static SemaphoreHandle_t config_lock = NULL; // Serializa temp_hum_apply_config
+
+// Instrumentação (microssegundos)
+static int64_t timer_fired_us = 0;   // Instante do último disparo do timer
+static int64_t callback_max_us = 0;  // Maior tempo gasto dentro do callback do esp_timer
+static int64_t measure_max_us = 0;   // Maior tempo de leitura do sensor na task
 
 static float temperature;
 static float humidity;
 
-static uint64_t *interval_ptr = NULL;
+static uint64_t sample_interval_s = 60;
+
+// Modo de aquisição aplicado ao sensor
+static bool sensor_mode_valid = false;
+static bool sensor_periodic = false;
+static sth31_mps_t sensor_mps;
+static SensorConfig_Repeatability sensor_repeatability;
 
 /// ============================
 /// Geração dos dados simulados
@@ -40,60 +70,192 @@ static uint64_t *interval_ptr = NULL;
 // }
 
 /// ============================
-/// Callback do Timer
+/// Modo de aquisição do STH31
 /// ============================
-static void timer_callback(void *arg)
+// Em intervalos curtos o sensor fica em aquisição periódica na menor taxa com
+// período estritamente menor que o intervalo (com período igual, qualquer
+// deriva de fase faria o Fetch Data encontrar o buffer vazio), e cada amostra é
+// um único Fetch Data. Em intervalos longos cada amostra é uma medição single
+// shot e o sensor dorme entre elas.
+static void update_sensor_mode(void)
 {
-    // generate_temp_hum_data();
+    bool periodic = sample_interval_s <= SENSOR_PERIODIC_MAX_INTERVAL_S;
+    sth31_mps_t mps = (sample_interval_s < 2) ? STH31_MPS_2 : STH31_MPS_1;
+
+    if (sensor_mode_valid && periodic == sensor_periodic && sth31_is_periodic() == periodic &&
+        (!periodic || mps == sensor_mps) && repeatability == sensor_repeatability)
+        return;
 
-    //Faz a leitura do sensor se não estiver no processo de transferir os logs.
-    if (!transfer_active)
+    sth31_set_repeatability((sth31_repeatability_t)repeatability);
+    if (periodic)
+        sensor_mode_valid = sth31_start_periodic(mps, (sth31_repeatability_t)repeatability) == ESP_OK;
+    else
+        sensor_mode_valid = sth31_stop_periodic() == ESP_OK;
+    sensor_periodic = periodic;
+    sensor_mps = mps;
+    sensor_repeatability = repeatability;
+}
+
+/// ============================
+/// Task do sensor
+/// ============================
+// Faz a leitura do STH31 fora da task do esp_timer. A gravação (fila da task
+// de gravação) e a notificação BLE (fila de eventos do host NimBLE) também são
+// apenas enfileiradas daqui.
+static void sensor_task(void *param)
+{
+    for (;;)
     {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        update_sensor_mode();
+
+        int64_t start_us = esp_timer_get_time();
+        int64_t wakeup_us = start_us - timer_fired_us;
+
+        // A leitura continua durante downloads do log: a gravação é feita pela task
+        // de gravação e o download trabalha sobre um snapshot do log.
         // Leitura sensores STH31D
         esp_err_t err = sth31_get_temp_hum(&temperature, &humidity);
+
+        int64_t measure_us = esp_timer_get_time() - start_us;
+        if (measure_us > measure_max_us)
+            measure_max_us = measure_us;
+
         if (err == ESP_OK)
         {
             ESP_LOGI(TAG, "Temp: %.2f °C, Hum: %.2f %%", temperature, humidity);
 
-            // Notifica BLE
-            ble_notify_sensor();
+            // Um único timestamp por amostra: o mesmo no notify, na leitura GATT e no log
+            SensorData sample = {
+                .timestamp = getUnixTimestamp(),
+                .temperature = temperature,
+                .humidity = humidity,
+            };
+
+            // Publica o payload BLE já codificado e notifica
+            ble_live_publish_sample(&sample);
+            ble_post_notify_sensor();
+            ble_post_adv_refresh();
 
-            // Salva no log
-            nvs_save_sensor_data(temperature, humidity);
+            // Enfileira para o log
+            nvs_enqueue_sensor_data(&sample);
         }
         else
         {
-            ESP_LOGE(TAG, "Erro ao ler sensor: %s", esp_err_to_name(err));
+            sth31_stats_t stats;
+            sth31_get_stats(&stats);
+            ESP_LOGE(TAG, "Erro ao ler sensor: %s (erros CRC %lu, I2C %lu, descartes %lu)",
+                     esp_err_to_name(err), (unsigned long)stats.crc_errors,
+                     (unsigned long)stats.i2c_errors, (unsigned long)stats.failures);
         }
+
+        ESP_LOGD(TAG, "Tempos (us): callback max %lld | despertar %lld | leitura %lld (max %lld)",
+                 (long long)callback_max_us, (long long)wakeup_us, (long long)measure_us, (long long)measure_max_us);
+    }
+}
+
+/// ============================
+/// Callbacks dos Timers
+/// ============================
+// Rodam na task do esp_timer: apenas acordam a task do sensor, sem bloquear.
+// O timer periódico corre livre (o esp_timer agenda cada disparo a partir do
+// anterior, sem deriva); só é rearmado pelo one-shot de alinhamento.
+static void notify_sensor_task(void)
+{
+    int64_t start_us = esp_timer_get_time();
+    timer_fired_us = start_us;
+
+    xTaskNotifyGive(sensor_task_handle);
+
+    int64_t callback_us = esp_timer_get_time() - start_us;
+    if (callback_us > callback_max_us)
+        callback_max_us = callback_us;
+}
+
+static void sample_timer_callback(void *arg)
+{
+    notify_sensor_task();
+}
+
+// Primeiro disparo após (re)configuração: estamos na fronteira do intervalo,
+// daqui em diante o timer é periódico. Para o periódico antes de rearmar: ele
+// ainda está no intervalo antigo.
+static void align_timer_callback(void *arg)
+{
+    notify_sensor_task();
+
+    esp_err_t err = esp_timer_stop(sample_timer);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) // INVALID_STATE: não estava armado
+        ESP_LOGE(TAG, "Erro ao parar timer periódico: %s", esp_err_to_name(err));
+
+    err = esp_timer_start_periodic(sample_timer, atomic_load(&sample_period_us));
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Erro ao iniciar timer periódico: %s", esp_err_to_name(err));
+}
+
+// Agenda o próximo disparo no próximo múltiplo do intervalo no relógio Unix.
+// O periódico continua no intervalo antigo até o one-shot disparar.
+static void schedule_aligned(void)
+{
+    uint64_t period_us = sample_interval_s * 1000000ULL;
+    uint64_t delay_us = period_us - (getUnixTimeUs() % period_us);
+
+    atomic_store(&sample_period_us, period_us);
+
+    esp_err_t err = esp_timer_stop(align_timer);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+        ESP_LOGE(TAG, "Erro ao parar timer de alinhamento: %s", esp_err_to_name(err));
+
+    err = esp_timer_start_once(align_timer, delay_us);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Erro ao agendar timer de alinhamento: %s", esp_err_to_name(err));
+}
+
+void temp_hum_apply_config(uint64_t interval_s)
+{
+    if (interval_s == 0)
+    {
+        ESP_LOGW(TAG, "Intervalo inválido (0), mantendo %llu segundos", (unsigned long long)sample_interval_s);
+        return;
     }
 
-    if (interval_ptr)
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    if (interval_s != sample_interval_s)
     {
-        uint64_t interval_ms = (*interval_ptr) * 1000;
-        esp_timer_stop(timer_handle);
-        esp_timer_start_periodic(timer_handle, interval_ms * 1000); // Intervalo em microssegundos
+        sample_interval_s = interval_s;
+        schedule_aligned();
+        ESP_LOGI(TAG, "Intervalo de amostragem alterado para %llu segundos", (unsigned long long)sample_interval_s);
     }
+    xSemaphoreGive(config_lock);
 }
 
 /// ============================
 /// Inicialização do módulo
 /// ============================
-void temp_hum_init(uint64_t *interval_reference)
+void temp_hum_init(uint64_t interval_s)
 {
-    interval_ptr = interval_reference;
+    if (interval_s > 0)
+        sample_interval_s = interval_s;
 
     srand((unsigned int)time(NULL)); // Inicializa seed do rand()
 
-    const esp_timer_create_args_t timer_args = {
-        .callback = &timer_callback,
+    config_lock = xSemaphoreCreateMutex();
+    xTaskCreate(sensor_task, "sensor", SENSOR_TASK_STACK_SIZE, NULL, SENSOR_TASK_PRIORITY, &sensor_task_handle);
+
+    const esp_timer_create_args_t sample_timer_args = {
+        .callback = &sample_timer_callback,
         .name = "temp_hum_timer"};
+    const esp_timer_create_args_t align_timer_args = {
+        .callback = &align_timer_callback,
+        .name = "temp_hum_align"};
 
-    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_handle));
+    ESP_ERROR_CHECK(esp_timer_create(&sample_timer_args, &sample_timer));
+    ESP_ERROR_CHECK(esp_timer_create(&align_timer_args, &align_timer));
 
-    uint64_t interval_ms = (*interval_ptr) * 1000;
-    ESP_ERROR_CHECK(esp_timer_start_periodic(timer_handle, interval_ms * 1000));
+    schedule_aligned();
 
-    ESP_LOGI(TAG, "Módulo TEMP_HUM inicializado com intervalo de %llu segundos", *interval_ptr);
+    ESP_LOGI(TAG, "Módulo TEMP_HUM inicializado com intervalo de %llu segundos", (unsigned long long)sample_interval_s);
 }
 
 /// ============================
@@ -8,7 +8,10 @@
 #include "esp_timer.h"
 
 
-void temp_hum_init(uint64_t *interval_ref);
+void temp_hum_init(uint64_t interval_s);
+// Aplica um novo intervalo de amostragem (em segundos); as amostras passam a
+// cair nos múltiplos do intervalo no relógio Unix.
+void temp_hum_apply_config(uint64_t interval_s);
 float get_temperature(void);
 float get_humidity(void);
 